@@ -0,0 +1,488 @@
+#include "command.h"
+#include "project.h"
+#include "wallsnapper.h"
+
+#include <QtMath>
+#include <QtTest>
+
+
+static const int SPACING = 100;
+// Less than the item sizes, so items overlap their neighbours and the walls
+static const int DENSE_SPACING = 25;
+static const int PROBE_COUNT = 1000;
+
+// Micro-benchmarks for the hot paths of the model. Every benchmark runs on
+// synthetic projects of 100 to 100000 furniture items, with a quarter as many
+// walls. The collision benchmarks also run on a dense layout where neighbours
+// and walls overlap, so the exact tests are timed and not only the box
+// rejection. QtTest's -o option writes the results as XML, CSV or JUnit XML.
+class CoreBenchmark : public QObject {
+    Q_OBJECT
+
+private slots:
+    void rotatedBoundingRect_data();
+    void rotatedBoundingRect();
+
+    void collidesWithFurniture_data();
+    void collidesWithFurniture();
+
+    void collidesWithWalls_data();
+    void collidesWithWalls();
+
+    void findCollisions_data();
+    void findCollisions();
+
+    void wallIntersects_data();
+    void wallIntersects();
+
+    void wallHitTest_data();
+    void wallHitTest();
+
+    void wallSnap_data();
+    void wallSnap();
+
+    void moveCommandUndoRedo_data();
+    void moveCommandUndoRedo();
+
+    void deleteSelectionUndoRedo_data();
+    void deleteSelectionUndoRedo();
+
+private:
+    static void addSizes();
+    static void addLayouts();
+    static void fill(Project &project, int itemCount, int spacing = SPACING);
+    static QVector<QPointF> probePoints(const Project &project, int count);
+
+    // The lookup DesignArea::getWallAt() does for every click, counting the hits
+    static int wallHits(const Project &project, const QVector<QPointF> &points);
+
+    // Plain scans to check the indexed paths against
+    static bool hitsWallSlowly(const Project &project, const Furniture *item);
+    static int collidingItemsSlowly(const Project &project, int spacing);
+};
+
+void CoreBenchmark::addSizes()
+{
+    QTest::addColumn<int>("items");
+
+    for (int items : { 100, 1000, 10000, 100000 }) {
+        QTest::newRow(QByteArray::number(items)) << items;
+    }
+}
+
+void CoreBenchmark::addLayouts()
+{
+    QTest::addColumn<int>("items");
+    QTest::addColumn<int>("spacing");
+
+    for (int items : { 100, 1000, 10000, 100000 }) {
+        QTest::newRow(QByteArray::number(items) + " sparse") << items << SPACING;
+        QTest::newRow(QByteArray::number(items) + " dense") << items << DENSE_SPACING;
+    }
+}
+
+void CoreBenchmark::fill(Project &project, int itemCount, int spacing)
+{
+    // Items on a square grid, walls along every fourth row and column
+    int columns = qCeil(qSqrt(itemCount));
+    project.newProject(QSize(columns * spacing, columns * spacing));
+
+    static const FurnitureType types[] = { FurnitureType::Sofa, FurnitureType::Chair, FurnitureType::Table };
+
+    for (int i = 0; i < itemCount; ++i) {
+        QPointF position((i % columns) * spacing + spacing / 2, (i / columns) * spacing + spacing / 2);
+        Furniture *item = Project::createFurniture(types[i % 3], position);
+        item->setRotation((i % 8) * 45);
+        project.addFurniture(item);
+    }
+
+    int wallCount = itemCount / 4;
+    for (int i = 0; i < wallCount; ++i) {
+        int line = (i / 2) % columns;
+        int from = ((i / 2) / columns) * 4 * spacing;
+        int to = qMin(from + 4 * spacing, columns * spacing);
+
+        if (i % 2 == 0) {
+            project.addWall(Wall(QPoint(from, line * spacing), QPoint(to, line * spacing)));
+        }
+        else {
+            project.addWall(Wall(QPoint(line * spacing, from), QPoint(line * spacing, to)));
+        }
+    }
+
+    project.takeDirtyRegion();
+}
+
+QVector<QPointF> CoreBenchmark::probePoints(const Project &project, int count)
+{
+    // Fixed sequence, so every run probes the same points
+    QSize canvas = project.getCanvasSize();
+    QVector<QPointF> points;
+    quint32 state = 12345;
+
+    for (int i = 0; i < count; ++i) {
+        state = state * 1664525u + 1013904223u;
+        qreal x = (state >> 8) % canvas.width();
+        state = state * 1664525u + 1013904223u;
+        qreal y = (state >> 8) % canvas.height();
+        points.append(QPointF(x, y));
+    }
+
+    return points;
+}
+
+int CoreBenchmark::wallHits(const Project &project, const QVector<QPointF> &points)
+{
+    const qreal hitDistance = 5;
+    int hits = 0;
+
+    for (const QPointF &point : points) {
+        QRectF hitRect(point.x() - hitDistance, point.y() - hitDistance, 2 * hitDistance, 2 * hitDistance);
+
+        for (int i : project.wallsIn(hitRect)) {
+            QLineF line(project.walls()[i].startPoint(), project.walls()[i].endPoint());
+
+            qreal numerator = qAbs(line.dy() * point.x() - line.dx() * point.y() +
+                                   line.x2() * line.y1() - line.y2() * line.x1());
+            qreal denominator = qSqrt(line.dx() * line.dx() + line.dy() * line.dy());
+            qreal distance = denominator == 0 ? QLineF(line.p1(), point).length() : numerator / denominator;
+
+            if (distance <= hitDistance) {
+                ++hits;
+                break;
+            }
+        }
+    }
+
+    return hits;
+}
+
+bool CoreBenchmark::hitsWallSlowly(const Project &project, const Furniture *item)
+{
+    for (const Wall &wall : project.walls()) {
+        if (wall.intersects(item->rotatedBoundingRect())) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+int CoreBenchmark::collidingItemsSlowly(const Project &project, int spacing)
+{
+    const QList<Furniture*> &furniture = project.furniture();
+    int columns = qCeil(qSqrt(furniture.size()));
+
+    // Items further apart than the largest bounding box on the grid cannot touch
+    qreal largest = 0;
+    for (const Furniture *item : furniture) {
+        QRectF bounds = item->rotatedBoundingRect();
+        largest = qMax(largest, qMax(bounds.width(), bounds.height()));
+    }
+    int reach = qCeil(largest / spacing);
+
+    int count = 0;
+    for (int i = 0; i < furniture.size(); ++i) {
+        const Furniture *item = furniture[i];
+        bool colliding = false;
+
+        for (int wall : project.wallsIn(item->rotatedBoundingRect())) {
+            colliding = colliding || project.walls()[wall].intersects(item->rotatedBoundingRect());
+        }
+
+        int column = i % columns;
+        int row = i / columns;
+        for (int y = row - reach; y <= row + reach && !colliding; ++y) {
+            for (int x = column - reach; x <= column + reach && !colliding; ++x) {
+                int j = y * columns + x;
+                if (x < 0 || x >= columns || y < 0 || j >= furniture.size()) continue;
+
+                colliding = item->collidesWith(furniture[j]);
+            }
+        }
+
+        count += colliding;
+    }
+
+    return count;
+}
+
+void CoreBenchmark::rotatedBoundingRect_data()
+{
+    addSizes();
+}
+
+void CoreBenchmark::rotatedBoundingRect()
+{
+    QFETCH(int, items);
+
+    Project project;
+    fill(project, items);
+
+    qreal angle = 0;
+    qreal sum = 0;
+
+    // Every rotation change drops the cached outline
+    QBENCHMARK {
+        angle += 1;
+        for (Furniture *item : project.furniture()) {
+            item->setRotation(angle);
+            sum += item->rotatedBoundingRect().width();
+        }
+    }
+
+    QVERIFY(sum > 0);
+}
+
+void CoreBenchmark::collidesWithFurniture_data()
+{
+    addLayouts();
+}
+
+void CoreBenchmark::collidesWithFurniture()
+{
+    QFETCH(int, items);
+    QFETCH(int, spacing);
+
+    Project project;
+    fill(project, items, spacing);
+
+    // Sparse neighbours are further apart than any item is large
+    const QList<Furniture*> &furniture = project.furniture();
+    int expected = 0;
+    for (int i = 1; i < furniture.size(); ++i) {
+        expected += furniture[i]->collidesWith(furniture[i - 1]);
+    }
+    QCOMPARE(expected > 0, spacing == DENSE_SPACING);
+
+    int hits = 0;
+
+    QBENCHMARK {
+        hits = 0;
+        for (int i = 1; i < furniture.size(); ++i) {
+            hits += furniture[i]->collidesWith(furniture[i - 1]);
+        }
+    }
+
+    QCOMPARE(hits, expected);
+}
+
+void CoreBenchmark::collidesWithWalls_data()
+{
+    addLayouts();
+}
+
+void CoreBenchmark::collidesWithWalls()
+{
+    QFETCH(int, items);
+    QFETCH(int, spacing);
+
+    Project project;
+    fill(project, items, spacing);
+
+    // Scans every wall per item, so only a fixed sample is tested
+    const QList<Furniture*> &furniture = project.furniture();
+    int step = qMax(1, furniture.size() / 100);
+
+    int expected = 0;
+    for (int i = 0; i < furniture.size(); i += step) {
+        expected += hitsWallSlowly(project, furniture[i]);
+    }
+    if (spacing == SPACING) {
+        QCOMPARE(expected, 0);
+    }
+
+    int hits = 0;
+
+    QBENCHMARK {
+        hits = 0;
+        for (int i = 0; i < furniture.size(); i += step) {
+            hits += furniture[i]->collidesWith(project.packedWalls());
+        }
+    }
+
+    QCOMPARE(hits, expected);
+}
+
+void CoreBenchmark::findCollisions_data()
+{
+    addLayouts();
+}
+
+void CoreBenchmark::findCollisions()
+{
+    QFETCH(int, items);
+    QFETCH(int, spacing);
+
+    Project project;
+    fill(project, items, spacing);
+
+    int expected = collidingItemsSlowly(project, spacing);
+    QCOMPARE(expected > 0, spacing == DENSE_SPACING);
+
+    int collisions = 0;
+
+    QBENCHMARK {
+        collisions = int(project.findCollisions(project.furniture()).size());
+    }
+
+    QCOMPARE(collisions, expected);
+}
+
+void CoreBenchmark::wallIntersects_data()
+{
+    addSizes();
+}
+
+void CoreBenchmark::wallIntersects()
+{
+    QFETCH(int, items);
+
+    Project project;
+    fill(project, items);
+
+    QVector<QPointF> points = probePoints(project, PROBE_COUNT);
+    const QList<Wall> &walls = project.walls();
+
+    // The collision kernel gives the same answer for every wall
+    int expected = 0;
+    for (int i = 0; i < walls.size(); ++i) {
+        QRectF rect(points[i % PROBE_COUNT], QSizeF(SPACING, SPACING));
+        expected += project.packedWalls().anyIntersects(rect, QList<int>{ i });
+    }
+
+    int hits = 0;
+
+    QBENCHMARK {
+        hits = 0;
+        for (int i = 0; i < walls.size(); ++i) {
+            hits += walls[i].intersects(QRectF(points[i % PROBE_COUNT], QSizeF(SPACING, SPACING)));
+        }
+    }
+
+    QCOMPARE(hits, expected);
+}
+
+void CoreBenchmark::wallHitTest_data()
+{
+    addSizes();
+}
+
+void CoreBenchmark::wallHitTest()
+{
+    QFETCH(int, items);
+
+    Project project;
+    fill(project, items);
+
+    QVector<QPointF> points = probePoints(project, PROBE_COUNT);
+    int expected = wallHits(project, points);
+    int hits = 0;
+
+    QBENCHMARK {
+        hits = wallHits(project, points);
+    }
+
+    QCOMPARE(hits, expected);
+}
+
+void CoreBenchmark::wallSnap_data()
+{
+    addSizes();
+}
+
+void CoreBenchmark::wallSnap()
+{
+    QFETCH(int, items);
+
+    Project project;
+    fill(project, items);
+
+    QVector<QPointF> points = probePoints(project, PROBE_COUNT);
+
+    int expected = 0;
+    for (const QPointF &point : points) {
+        expected += WallSnapper::snap(project, point, 10).isValid();
+    }
+
+    int snapped = 0;
+
+    QBENCHMARK {
+        snapped = 0;
+        for (const QPointF &point : points) {
+            snapped += WallSnapper::snap(project, point, 10).isValid();
+        }
+    }
+
+    QCOMPARE(snapped, expected);
+}
+
+void CoreBenchmark::moveCommandUndoRedo_data()
+{
+    addSizes();
+}
+
+void CoreBenchmark::moveCommandUndoRedo()
+{
+    QFETCH(int, items);
+
+    Project project;
+    fill(project, items);
+
+    QList<FurnitureHandle> handles;
+    QList<QPointF> oldPositions;
+    QList<QPointF> newPositions;
+
+    for (Furniture *item : project.furniture()) {
+        handles.append(item->handle());
+        oldPositions.append(item->position());
+        newPositions.append(item->position() + QPointF(1, 1));
+    }
+
+    MoveFurnitureCommand command(project, handles, oldPositions, newPositions);
+    command.execute();
+
+    QBENCHMARK {
+        command.undo();
+        command.redo();
+    }
+
+    QCOMPARE(project.furniture().first()->position(), newPositions.first());
+}
+
+void CoreBenchmark::deleteSelectionUndoRedo_data()
+{
+    addSizes();
+}
+
+void CoreBenchmark::deleteSelectionUndoRedo()
+{
+    QFETCH(int, items);
+
+    Project project;
+    fill(project, items);
+
+    // Every tenth item and wall
+    QList<Furniture*> selectedFurniture;
+    for (int i = 0; i < project.furniture().size(); i += 10) {
+        selectedFurniture.append(project.furniture()[i]);
+    }
+
+    QList<int> selectedWalls;
+    for (int i = 0; i < project.walls().size(); i += 10) {
+        selectedWalls.append(i);
+    }
+
+    DeleteSelectionCommand command(project, selectedFurniture, selectedWalls);
+
+    QBENCHMARK {
+        command.redo();
+        command.undo();
+    }
+
+    QCOMPARE(int(project.furniture().size()), items);
+}
+
+QTEST_GUILESS_MAIN(CoreBenchmark)
+
+#include "bench_core.moc"
@@ -0,0 +1,266 @@
+#include "projectgenerator.h"
+#include "scenerenderer.h"
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QImage>
+#include <QtMath>
+#include <QtTest>
+
+
+// Rendering benchmarks on an offscreen QImage, per layer and for whole frames.
+// Projects of 1000 to 100000 furniture items come from ProjectGenerator and
+// are shown either whole, as after fitting to the window, or at real size.
+// Every case runs with antialiasing on and off.
+class RenderBenchmark : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void grid_data();
+    void grid();
+
+    void walls_data();
+    void walls();
+
+    void furniture_data();
+    void furniture();
+
+    void selection_data();
+    void selection();
+
+    void frame_data();
+    void frame();
+
+private:
+    QHash<int, Project*> m_projects;
+    QHash<int, QList<int>> m_selectedWalls;
+
+    static void addRows();
+    static SceneRenderer::View viewFor(const Project &project, bool zoomedIn);
+};
+
+static const QSize FRAME_SIZE(1920, 1080);
+static const int SPACING = 100;
+static const int SIZES[] = { 1000, 10000, 100000 };
+
+void RenderBenchmark::initTestCase()
+{
+    for (int items : SIZES) {
+        int columns = qCeil(qSqrt(items));
+
+        ProjectGenerator::Parameters parameters;
+        parameters.canvasSize = QSize(columns * SPACING, columns * SPACING);
+        parameters.wallCount = items / 10;
+        parameters.furnitureCount = items;
+        parameters.rotation = ProjectGenerator::Rotation::Octants;
+        parameters.placementAttempts = 3;
+        parameters.seed = items;
+
+        Project *project = new Project;
+        ProjectGenerator::generate(*project, parameters);
+
+        // Every tenth item and wall is selected
+        const QList<Furniture*> &furniture = project->furniture();
+        for (int i = 0; i < furniture.size(); i += 10) {
+            furniture[i]->setSelected(true);
+        }
+
+        QList<int> selectedWalls;
+        for (int i = 0; i < project->walls().size(); i += 10) {
+            selectedWalls.append(i);
+        }
+
+        m_projects.insert(items, project);
+        m_selectedWalls.insert(items, selectedWalls);
+    }
+}
+
+void RenderBenchmark::cleanupTestCase()
+{
+    qDeleteAll(m_projects);
+    m_projects.clear();
+    m_selectedWalls.clear();
+}
+
+void RenderBenchmark::addRows()
+{
+    QTest::addColumn<int>("items");
+    QTest::addColumn<bool>("zoomedIn");
+    QTest::addColumn<bool>("antialiasing");
+
+    for (int items : SIZES) {
+        for (bool zoomedIn : { false, true }) {
+            for (bool antialiasing : { true, false }) {
+                QByteArray name = QByteArray::number(items) + (zoomedIn ? ":1x" : ":fit")
+                                  + (antialiasing ? ":aa" : ":no-aa");
+                QTest::newRow(name) << items << zoomedIn << antialiasing;
+            }
+        }
+    }
+}
+
+SceneRenderer::View RenderBenchmark::viewFor(const Project &project, bool zoomedIn)
+{
+    QSizeF canvas = project.getCanvasSize();
+
+    SceneRenderer::View view;
+    view.zoom = zoomedIn ? 1 : qMin(FRAME_SIZE.width() / canvas.width(), FRAME_SIZE.height() / canvas.height());
+    view.origin = QPointF(canvas.width() / 2, canvas.height() / 2)
+                  - QPointF(FRAME_SIZE.width() / 2.0, FRAME_SIZE.height() / 2.0) / view.zoom;
+
+    return view;
+}
+
+void RenderBenchmark::grid_data()
+{
+    addRows();
+}
+
+void RenderBenchmark::grid()
+{
+    QFETCH(int, items);
+    QFETCH(bool, zoomedIn);
+    QFETCH(bool, antialiasing);
+
+    const Project &project = *m_projects.value(items);
+    SceneRenderer::View view = viewFor(project, zoomedIn);
+
+    SceneRenderer renderer;
+    renderer.setAntialiasing(antialiasing);
+
+    QImage image(FRAME_SIZE, QImage::Format_ARGB32_Premultiplied);
+    QPainter painter(&image);
+
+    QBENCHMARK {
+        renderer.paintGrid(painter, project, view, image.rect());
+    }
+}
+
+void RenderBenchmark::walls_data()
+{
+    addRows();
+}
+
+void RenderBenchmark::walls()
+{
+    QFETCH(int, items);
+    QFETCH(bool, zoomedIn);
+    QFETCH(bool, antialiasing);
+
+    const Project &project = *m_projects.value(items);
+    SceneRenderer::View view = viewFor(project, zoomedIn);
+
+    SceneRenderer renderer;
+    renderer.setAntialiasing(antialiasing);
+
+    QImage image(FRAME_SIZE, QImage::Format_ARGB32_Premultiplied);
+    QPainter painter(&image);
+
+    QBENCHMARK {
+        renderer.paintWalls(painter, project, view, image.rect());
+    }
+}
+
+void RenderBenchmark::furniture_data()
+{
+    addRows();
+}
+
+void RenderBenchmark::furniture()
+{
+    QFETCH(int, items);
+    QFETCH(bool, zoomedIn);
+    QFETCH(bool, antialiasing);
+
+    const Project &project = *m_projects.value(items);
+    SceneRenderer::View view = viewFor(project, zoomedIn);
+
+    SceneRenderer renderer;
+    renderer.setAntialiasing(antialiasing);
+
+    QImage image(FRAME_SIZE, QImage::Format_ARGB32_Premultiplied);
+    QPainter painter(&image);
+
+    // The first pass fills the sprite cache, as the first paint in the app does
+    renderer.paintFurniture(painter, project, view, image.rect());
+
+    QBENCHMARK {
+        renderer.paintFurniture(painter, project, view, image.rect());
+    }
+}
+
+void RenderBenchmark::selection_data()
+{
+    addRows();
+}
+
+void RenderBenchmark::selection()
+{
+    QFETCH(int, items);
+    QFETCH(bool, zoomedIn);
+    QFETCH(bool, antialiasing);
+
+    const Project &project = *m_projects.value(items);
+    const QList<int> &selectedWalls = m_selectedWalls[items];
+    SceneRenderer::View view = viewFor(project, zoomedIn);
+
+    SceneRenderer renderer;
+    renderer.setAntialiasing(antialiasing);
+
+    QImage image(FRAME_SIZE, QImage::Format_ARGB32_Premultiplied);
+    QPainter painter(&image);
+
+    renderer.paintSelection(painter, project, view, image.rect(), selectedWalls);
+
+    QBENCHMARK {
+        renderer.paintSelection(painter, project, view, image.rect(), selectedWalls);
+    }
+}
+
+void RenderBenchmark::frame_data()
+{
+    addRows();
+}
+
+void RenderBenchmark::frame()
+{
+    QFETCH(int, items);
+    QFETCH(bool, zoomedIn);
+    QFETCH(bool, antialiasing);
+
+    const Project &project = *m_projects.value(items);
+    const QList<int> &selectedWalls = m_selectedWalls[items];
+    SceneRenderer::View view = viewFor(project, zoomedIn);
+
+    SceneRenderer renderer;
+    renderer.setAntialiasing(antialiasing);
+
+    QImage image(FRAME_SIZE, QImage::Format_ARGB32_Premultiplied);
+
+    {
+        QPainter painter(&image);
+        renderer.paint(painter, project, view, image.rect(), selectedWalls);
+    }
+
+    // Complete repaints, as while zooming or panning when the background
+    // cache is redrawn every frame. Reported as frames per second.
+    const qint64 MIN_DURATION = 500;
+    QElapsedTimer timer;
+    int frames = 0;
+    timer.start();
+
+    do {
+        QPainter painter(&image);
+        renderer.paint(painter, project, view, image.rect(), selectedWalls);
+        ++frames;
+    } while (timer.elapsed() < MIN_DURATION);
+
+    QTest::setBenchmarkResult(frames * 1e9 / timer.nsecsElapsed(), QTest::FramesPerSecond);
+}
+
+QTEST_MAIN(RenderBenchmark)
+
+#include "bench_render.moc"
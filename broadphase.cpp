@@ -0,0 +1,45 @@
+#include "broadphase.h"
+
+#include <algorithm>
+
+
+QVector<QPair<int, int>> SweepAndPrune::findPairs(const QVector<QRectF> &boxes, const QVector<bool> &active)
+{
+    QVector<QPair<int, int>> pairs;
+
+    // Sort along the x-axis by the left edge
+    QVector<int> order(boxes.size());
+    for (int i = 0; i < order.size(); ++i) {
+        order[i] = i;
+    }
+
+    std::sort(order.begin(), order.end(), [&boxes](int a, int b) {
+        return boxes[a].left() < boxes[b].left();
+    });
+
+    // Boxes whose x-interval still overlaps the sweep position
+    QVector<int> open;
+
+    for (int current : order) {
+        const QRectF &box = boxes[current];
+
+        for (int i = open.size() - 1; i >= 0; --i) {
+            if (boxes[open[i]].right() < box.left()) {
+                open.removeAt(i);
+            }
+        }
+
+        for (int other : open) {
+            if (!active[current] && !active[other]) continue;
+
+            const QRectF &otherBox = boxes[other];
+            if (otherBox.top() <= box.bottom() && box.top() <= otherBox.bottom()) {
+                pairs.append(qMakePair(qMin(current, other), qMax(current, other)));
+            }
+        }
+
+        open.append(current);
+    }
+
+    return pairs;
+}
@@ -0,0 +1,16 @@
+#ifndef BROADPHASE_H
+#define BROADPHASE_H
+
+#include <QPair>
+#include <QRectF>
+#include <QVector>
+
+
+class SweepAndPrune {
+public:
+    // Index pairs (i < j) whose boxes overlap on both axes. Pairs where neither
+    // box is active are skipped, so static-vs-static overlaps are never reported.
+    static QVector<QPair<int, int>> findPairs(const QVector<QRectF> &boxes, const QVector<bool> &active);
+};
+
+#endif // BROADPHASE_H
@@ -1,31 +1,54 @@
 #include "command.h"
 
 
+// Project indices of the given items in ascending order, with the items in the same order
+static void collectFurniture(Project &project, const QList<Furniture*> &selectedFurniture,
+                             QList<int> &indices, QList<Furniture*> &items)
+{
+    QList<QPair<int, Furniture*>> entries;
+    for (Furniture *furniture : selectedFurniture) {
+        int index = project.indexOfFurniture(furniture);
+        if (index != -1) {
+            entries.append(qMakePair(index, furniture));
+        }
+    }
+
+    std::sort(entries.begin(), entries.end(), [](const QPair<int, Furniture*> &a, const QPair<int, Furniture*> &b) {
+        return a.first < b.first;
+    });
+
+    for (const QPair<int, Furniture*> &entry : entries) {
+        indices.append(entry.first);
+        items.append(entry.second);
+    }
+}
+
 Command::Command() {}
 
 Command::~Command() {}
 
-AddFurnitureCommand::AddFurnitureCommand(QList<Furniture *> &furnitureList, Furniture *furniture)
-    : m_furnitureList(furnitureList), m_furniture(furniture) {}
+AddFurnitureCommand::AddFurnitureCommand(Project &project, Furniture *furniture)
+    : m_project(project), m_furniture(furniture), m_ownsItem(true) {}
 
 AddFurnitureCommand::~AddFurnitureCommand()
 {
     if (m_ownsItem) {
+        m_project.releaseFurniture(m_furniture);
         delete m_furniture;
     }
 }
 
 void AddFurnitureCommand::execute()
 {
-    m_furnitureList.append(m_furniture);
+    m_project.addFurniture(m_furniture);
     m_ownsItem = false;
 }
 
 void AddFurnitureCommand::undo()
 {
-    int index = m_furnitureList.indexOf(m_furniture);
+    int index = m_project.indexOfFurniture(m_furniture);
     if (index != -1) {
-        m_furnitureList.removeAt(index);
+        m_project.takeFurnitureAt(index);
         m_ownsItem = true;
     }
 }
@@ -36,44 +59,84 @@ void AddFurnitureCommand::redo()
 }
 
 
-DeleteFurnitureCommand::DeleteFurnitureCommand(QList<Furniture *> &furnitureList, const QList<Furniture *> &selectedFurniture)
-    : m_furnitureList(furnitureList) {
-    for (Furniture *furniture : selectedFurniture) {
-        int index = m_furnitureList.indexOf(furniture);
+AddFurnitureGroupCommand::AddFurnitureGroupCommand(Project &project, const QList<Furniture *> &furniture)
+    : m_project(project), m_furniture(furniture), m_ownsItems(true) {}
+
+AddFurnitureGroupCommand::~AddFurnitureGroupCommand()
+{
+    if (m_ownsItems) {
+        for (Furniture *item : m_furniture) {
+            m_project.releaseFurniture(item);
+            delete item;
+        }
+    }
+}
+
+void AddFurnitureGroupCommand::execute()
+{
+    for (Furniture *item : m_furniture) {
+        m_project.addFurniture(item);
+    }
+
+    m_ownsItems = false;
+}
+
+void AddFurnitureGroupCommand::undo()
+{
+    // The items sit at the end of the list, last one first keeps the others in place
+    for (int i = m_furniture.size() - 1; i >= 0; --i) {
+        int index = m_project.indexOfFurniture(m_furniture[i]);
         if (index != -1) {
-            m_itemIndices.append(index);
-            m_deletedItems.append(furniture->clone());
+            m_project.takeFurnitureAt(index);
         }
     }
+
+    m_ownsItems = true;
+}
+
+void AddFurnitureGroupCommand::redo()
+{
+    execute();
+}
+
+
+DeleteFurnitureCommand::DeleteFurnitureCommand(Project &project, const QList<Furniture *> &selectedFurniture)
+    : m_project(project), m_ownsItems(false) {
+    collectFurniture(m_project, selectedFurniture, m_itemIndices, m_deletedItems);
 }
 
 DeleteFurnitureCommand::~DeleteFurnitureCommand()
 {
-    for (Furniture *item: m_deletedItems) {
-        delete item;
+    if (m_ownsItems) {
+        for (Furniture *item: m_deletedItems) {
+            m_project.releaseFurniture(item);
+            delete item;
+        }
     }
 }
 
 void DeleteFurnitureCommand::execute()
 {
     // Descending order for shifting problem
-    std::sort(m_itemIndices.begin(), m_itemIndices.end(), std::greater<int>());
-
-    for (int index: m_itemIndices) {
-        if (index < m_furnitureList.size()) {
-            delete m_furnitureList.takeAt(index);
+    for (int i = m_itemIndices.size() - 1; i >= 0; --i) {
+        if (m_itemIndices[i] < m_project.furnitureCount()) {
+            m_project.takeFurnitureAt(m_itemIndices[i]);
         }
     }
+
+    m_ownsItems = true;
 }
 
 void DeleteFurnitureCommand::undo()
 {
+    // Ascending order puts every item back at its original index
     for (int i = 0; i < m_deletedItems.size(); ++i) {
-        int index = m_itemIndices[m_deletedItems.size() - i - 1];
-        if (index <= m_furnitureList.size()) {
-            m_furnitureList.insert(index, m_deletedItems[i]->clone());
+        if (m_itemIndices[i] <= m_project.furnitureCount()) {
+            m_project.insertFurniture(m_itemIndices[i], m_deletedItems[i]);
         }
     }
+
+    m_ownsItems = false;
 }
 
 void DeleteFurnitureCommand::redo()
@@ -82,31 +145,27 @@ void DeleteFurnitureCommand::redo()
 }
 
 
-MoveFurnitureCommand::MoveFurnitureCommand(QList<Furniture *> &furnitureList, const QList<QUuid> &furnitureIds, const QList<QPointF> &oldPoisitions, const QList<QPointF> &newPositions)
-    : m_furnitureList(furnitureList), m_furnitureIds(furnitureIds), m_oldPositions(oldPoisitions), m_newPositions(newPositions) {}
+MoveFurnitureCommand::MoveFurnitureCommand(Project &project, const QList<FurnitureHandle> &furnitureHandles, const QList<QPointF> &oldPoisitions, const QList<QPointF> &newPositions)
+    : m_project(project), m_furnitureHandles(furnitureHandles), m_oldPositions(oldPoisitions), m_newPositions(newPositions) {}
 
 MoveFurnitureCommand::~MoveFurnitureCommand() {}
 
 void MoveFurnitureCommand::execute()
 {
-    for (int i = 0; i < m_furnitureIds.size(); ++i) {
-        for (Furniture *furniture : m_furnitureList) {
-            if (furniture->id() == m_furnitureIds[i]) {
-                furniture->setPosition(m_newPositions[i]);
-                break;
-            }
+    for (int i = 0; i < m_furnitureHandles.size(); ++i) {
+        Furniture *furniture = m_project.furnitureByHandle(m_furnitureHandles[i]);
+        if (furniture) {
+            m_project.setFurniturePosition(furniture, m_newPositions[i]);
         }
     }
 }
 
 void MoveFurnitureCommand::undo()
 {
-    for (int i = 0; i < m_furnitureIds.size(); ++i) {
-        for (Furniture *furniture : m_furnitureList) {
-            if (furniture->id() == m_furnitureIds[i]) {
-                furniture->setPosition(m_oldPositions[i]);
-                break;
-            }
+    for (int i = 0; i < m_furnitureHandles.size(); ++i) {
+        Furniture *furniture = m_project.furnitureByHandle(m_furnitureHandles[i]);
+        if (furniture) {
+            m_project.setFurniturePosition(furniture, m_oldPositions[i]);
         }
     }
 }
@@ -117,19 +176,25 @@ void MoveFurnitureCommand::redo()
 }
 
 
-RotateFurnitureCommand::RotateFurnitureCommand(Furniture *furniture, qreal oldRotation, qreal newRotation)
-    : m_furniture(furniture), m_oldRotation(oldRotation), m_newRotation(newRotation) {}
+RotateFurnitureCommand::RotateFurnitureCommand(Project &project, FurnitureHandle furnitureHandle, qreal oldRotation, qreal newRotation)
+    : m_project(project), m_furnitureHandle(furnitureHandle), m_oldRotation(oldRotation), m_newRotation(newRotation) {}
 
 RotateFurnitureCommand::~RotateFurnitureCommand() {}
 
 void RotateFurnitureCommand::execute()
 {
-    m_furniture->setRotation(m_newRotation);
+    Furniture *furniture = m_project.furnitureByHandle(m_furnitureHandle);
+    if (furniture) {
+        m_project.setFurnitureRotation(furniture, m_newRotation);
+    }
 }
 
 void RotateFurnitureCommand::undo()
 {
-    m_furniture->setRotation(m_oldRotation);
+    Furniture *furniture = m_project.furnitureByHandle(m_furnitureHandle);
+    if (furniture) {
+        m_project.setFurnitureRotation(furniture, m_oldRotation);
+    }
 }
 
 void RotateFurnitureCommand::redo()
@@ -138,19 +203,19 @@ void RotateFurnitureCommand::redo()
 }
 
 
-AddWallCommand::AddWallCommand(QList<Wall> &wallList, const Wall &wall): m_wallList(wallList), m_wall(wall) {}
+AddWallCommand::AddWallCommand(Project &project, const Wall &wall): m_project(project), m_wall(wall) {}
 
 AddWallCommand::~AddWallCommand() {}
 
 void AddWallCommand::execute()
 {
-    m_wallList.append(m_wall);
+    m_project.addWall(m_wall);
 }
 
 void AddWallCommand::undo()
 {
-    if (!m_wallList.isEmpty()) {
-        m_wallList.removeLast();
+    if (!m_project.walls().isEmpty()) {
+        m_project.removeWallAt(m_project.walls().size() - 1);
     }
 }
 
@@ -160,9 +225,9 @@ void AddWallCommand::redo()
 }
 
 
-DeleteWallCommand::DeleteWallCommand(QList<Wall> &wallList, int wallIndex) : m_wallList(wallList), m_wallIndex(wallIndex) {
-    if (wallIndex >= 0 && wallIndex < wallList.size()) {
-        m_deletedWall = wallList[wallIndex];
+DeleteWallCommand::DeleteWallCommand(Project &project, int wallIndex) : m_project(project), m_wallIndex(wallIndex) {
+    if (wallIndex >= 0 && wallIndex < project.walls().size()) {
+        m_deletedWall = project.walls()[wallIndex];
     }
 }
 
@@ -170,15 +235,15 @@ DeleteWallCommand::~DeleteWallCommand() {}
 
 void DeleteWallCommand::execute()
 {
-    if (m_wallIndex >= 0 && m_wallIndex < m_wallList.size()) {
-        m_wallList.removeAt(m_wallIndex);
+    if (m_wallIndex >= 0 && m_wallIndex < m_project.walls().size()) {
+        m_project.removeWallAt(m_wallIndex);
     }
 }
 
 void DeleteWallCommand::undo()
 {
-    if (m_wallIndex >= 0 && m_wallIndex < m_wallList.size()) {
-        m_wallList.insert(m_wallIndex, m_deletedWall);
+    if (m_wallIndex >= 0 && m_wallIndex < m_project.walls().size()) {
+        m_project.insertWall(m_wallIndex, m_deletedWall);
     }
 }
 
@@ -187,59 +252,58 @@ void DeleteWallCommand::redo()
     execute();
 }
 
-DeleteSelectionCommand::DeleteSelectionCommand(QList<Furniture *> &furnitureList, const QList<Furniture*> &selectedFurniture, QList<Wall> &wallList, const QList<int> &selectedWallIndices)
-    : m_furnitureList(furnitureList), m_wallList(wallList)
+DeleteSelectionCommand::DeleteSelectionCommand(Project &project, const QList<Furniture*> &selectedFurniture, const QList<int> &selectedWallIndices)
+    : m_project(project), m_ownsItems(false)
 {
-    for (Furniture *furniture : selectedFurniture) {
-        int index = m_furnitureList.indexOf(furniture);
-        if (index != -1) {
-            m_itemIndices.append(index);
-            m_deletedItems.append(furniture->clone());
+    collectFurniture(m_project, selectedFurniture, m_itemIndices, m_deletedItems);
+
+    for (int index : selectedWallIndices) {
+        if (index >= 0 && index < project.walls().size() && !m_wallIndices.contains(index)) {
+            m_wallIndices.append(index);
         }
     }
 
-    m_wallIndices = selectedWallIndices;
+    std::sort(m_wallIndices.begin(), m_wallIndices.end());
     for (int index : m_wallIndices) {
-        if (index >= 0 && index < wallList.size()) {
-            m_deletedWalls.append(wallList[index]);
-        }
+        m_deletedWalls.append(project.walls()[index]);
     }
 }
 
 DeleteSelectionCommand::~DeleteSelectionCommand() {
-    for (Furniture *item: m_deletedItems) {
-        delete item;
+    if (m_ownsItems) {
+        for (Furniture *item: m_deletedItems) {
+            m_project.releaseFurniture(item);
+            delete item;
+        }
     }
 }
 
 
 void DeleteSelectionCommand::execute() {
-    std::sort(m_itemIndices.begin(), m_itemIndices.end(), std::greater<int>());
-
-    for (int index: m_itemIndices) {
-        if (index < m_furnitureList.size()) {
-            delete m_furnitureList.takeAt(index);
+    for (int i = m_itemIndices.size() - 1; i >= 0; --i) {
+        if (m_itemIndices[i] < m_project.furnitureCount()) {
+            m_project.takeFurnitureAt(m_itemIndices[i]);
         }
     }
 
-    std::sort(m_wallIndices.begin(), m_wallIndices.end(), std::greater<int>());
+    m_ownsItems = true;
 
-    for (int index: m_wallIndices) {
-        if (index < m_wallList.size()) {
-            m_wallList.removeAt(index);
+    for (int i = m_wallIndices.size() - 1; i >= 0; --i) {
+        if (m_wallIndices[i] < m_project.walls().size()) {
+            m_project.removeWallAt(m_wallIndices[i]);
         }
     }
 }
 
 void DeleteSelectionCommand::undo() {
-    for (int i = m_deletedItems.size() - 1; i >= 0; --i) {
-        int originalIndex = m_itemIndices[i];
-        m_furnitureList.insert(originalIndex, m_deletedItems[i]->clone());
+    for (int i = 0; i < m_deletedItems.size(); ++i) {
+        m_project.insertFurniture(m_itemIndices[i], m_deletedItems[i]);
     }
 
-    for (int i = m_deletedWalls.size() - 1; i >= 0; --i) {
-        int originalIndex = m_wallIndices[i];
-        m_wallList.insert(originalIndex, m_deletedWalls[i]);
+    m_ownsItems = false;
+
+    for (int i = 0; i < m_deletedWalls.size(); ++i) {
+        m_project.insertWall(m_wallIndices[i], m_deletedWalls[i]);
     }
 }
 
@@ -2,6 +2,7 @@
 #define COMMAND_H
 
 #include "furniture.h"
+#include "project.h"
 
 class Command {
 public:
@@ -16,7 +17,7 @@ public:
 
 class AddFurnitureCommand : public Command {
 public:
-    AddFurnitureCommand(QList<Furniture*> &furnitureList, Furniture *furniture);
+    AddFurnitureCommand(Project &project, Furniture *furniture);
     ~AddFurnitureCommand();
 
     void execute() override;
@@ -24,15 +25,32 @@ public:
     void redo() override;
 
 private:
-    QList<Furniture*> &m_furnitureList;
+    Project &m_project;
     Furniture *m_furniture;
     bool m_ownsItem;
 };
 
 
+// Several new items as one undo step, e.g. a paste
+class AddFurnitureGroupCommand : public Command {
+public:
+    AddFurnitureGroupCommand(Project &project, const QList<Furniture*> &furniture);
+    ~AddFurnitureGroupCommand();
+
+    void execute() override;
+    void undo() override;
+    void redo() override;
+
+private:
+    Project &m_project;
+    QList<Furniture*> m_furniture;
+    bool m_ownsItems;
+};
+
+
 class DeleteFurnitureCommand: public Command {
 public:
-    DeleteFurnitureCommand(QList<Furniture*> &furnitureList, const QList<Furniture*> &selectedFurniture);
+    DeleteFurnitureCommand(Project &project, const QList<Furniture*> &selectedFurniture);
     ~DeleteFurnitureCommand();
 
     void execute() override;
@@ -40,15 +58,18 @@ public:
     void redo() override;
 
 private:
-    QList<Furniture*> &m_furnitureList;
+    // The removed objects themselves are kept, so their handles stay valid for
+    // other commands in the history. Owned by this command while deleted.
+    Project &m_project;
     QList<Furniture*> m_deletedItems;
     QList<int> m_itemIndices;
+    bool m_ownsItems;
 };
 
 
 class MoveFurnitureCommand: public Command {
 public:
-    MoveFurnitureCommand(QList<Furniture*> &furnitureList, const QList<QUuid> &furnitureIds,
+    MoveFurnitureCommand(Project &project, const QList<FurnitureHandle> &furnitureHandles,
                          const QList<QPointF> &oldPoisitions, const QList<QPointF> &newPositions);
 
     ~MoveFurnitureCommand();
@@ -58,8 +79,8 @@ public:
     void redo() override;
 
 private:
-    QList<Furniture*> &m_furnitureList;
-    QList<QUuid> m_furnitureIds;
+    Project &m_project;
+    QList<FurnitureHandle> m_furnitureHandles;
     QList<QPointF> m_oldPositions;
     QList<QPointF> m_newPositions;
 };
@@ -67,7 +88,7 @@ private:
 
 class RotateFurnitureCommand: public Command {
 public:
-    RotateFurnitureCommand(Furniture *furniture, qreal oldRotation, qreal newRotation);
+    RotateFurnitureCommand(Project &project, FurnitureHandle furnitureHandle, qreal oldRotation, qreal newRotation);
     ~RotateFurnitureCommand();
 
     void execute() override;
@@ -75,7 +96,8 @@ public:
     void redo() override;
 
 private:
-    Furniture *m_furniture;
+    Project &m_project;
+    FurnitureHandle m_furnitureHandle;
     qreal m_oldRotation;
     qreal m_newRotation;
 };
@@ -83,7 +105,7 @@ private:
 
 class AddWallCommand: public Command {
 public:
-    AddWallCommand(QList<Wall> &wallList, const Wall &wall);
+    AddWallCommand(Project &project, const Wall &wall);
     ~AddWallCommand();
 
     void execute() override;
@@ -91,14 +113,14 @@ public:
     void redo() override;
 
 private:
-    QList<Wall> &m_wallList;
+    Project &m_project;
     Wall m_wall;
 };
 
 
 class DeleteWallCommand: public Command {
 public:
-    DeleteWallCommand(QList<Wall> &wallList, int wallIndex);
+    DeleteWallCommand(Project &project, int wallIndex);
     ~DeleteWallCommand();
 
     void execute() override;
@@ -106,15 +128,15 @@ public:
     void redo() override;
 
 private:
-    QList<Wall> &m_wallList;
+    Project &m_project;
     int m_wallIndex;
     Wall m_deletedWall;
 };
 
 class DeleteSelectionCommand: public Command {
 public:
-    DeleteSelectionCommand(QList<Furniture*> &furnitureList, const QList<Furniture*> &selectedFurniture,
-                           QList<Wall> &wallList, const QList<int> &selectedWallIndices);
+    DeleteSelectionCommand(Project &project, const QList<Furniture*> &selectedFurniture,
+                           const QList<int> &selectedWallIndices);
 
     ~DeleteSelectionCommand();
 
@@ -123,11 +145,11 @@ public:
     void redo() override;
 
 private:
-    QList<Furniture*> &m_furnitureList;
+    Project &m_project;
     QList<Furniture*> m_deletedItems;
     QList<int> m_itemIndices;
+    bool m_ownsItems;
 
-    QList<Wall> &m_wallList;
     QList<Wall> m_deletedWalls;
     QList<int> m_wallIndices;
 };
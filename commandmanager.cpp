@@ -1,7 +1,8 @@
 #include "commandmanager.h"
+#include "projectjournal.h"
 
 
-CommandManager::CommandManager(QObject *parent): QObject(parent) {}
+CommandManager::CommandManager(QObject *parent): QObject(parent), m_journal(nullptr) {}
 
 CommandManager::~CommandManager()
 {
@@ -10,7 +11,9 @@ CommandManager::~CommandManager()
 
 void CommandManager::execute(Command *command)
 {
+    if (m_journal) m_journal->beginCommand();
     command->execute();
+    if (m_journal) m_journal->endCommand();
     m_undoStack.push(command);
 
     // On command execution
@@ -28,7 +31,9 @@ void CommandManager::undo()
     if (m_undoStack.isEmpty()) return;
 
     Command *command = m_undoStack.pop();
+    if (m_journal) m_journal->beginCommand();
     command->undo();
+    if (m_journal) m_journal->endCommand();
     m_redoStack.push(command);
 
     emit undoRedoStateChanged();
@@ -39,7 +44,9 @@ void CommandManager::redo()
     if (m_redoStack.isEmpty()) return;
 
     Command *command = m_redoStack.pop();
+    if (m_journal) m_journal->beginCommand();
     command->redo();
+    if (m_journal) m_journal->endCommand();
     m_undoStack.push(command);
 
     emit undoRedoStateChanged();
@@ -69,3 +76,8 @@ void CommandManager::clear()
 
     emit undoRedoStateChanged();
 }
+
+void CommandManager::setJournal(ProjectJournal *journal)
+{
+    m_journal = journal;
+}
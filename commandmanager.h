@@ -6,6 +6,7 @@
 #include <QObject>
 #include <QStack>
 
+class ProjectJournal;
 
 class CommandManager: public QObject {
     Q_OBJECT
@@ -23,6 +24,9 @@ public:
 
     void clear();
 
+    // Every execute, undo and redo is recorded as one journal command
+    void setJournal(ProjectJournal *journal);
+
 signals:
     void undoRedoStateChanged();
     void commandExecuted();
@@ -30,6 +34,7 @@ signals:
 private:
     QStack<Command*> m_undoStack;
     QStack<Command*> m_redoStack;
+    ProjectJournal *m_journal;
 };
 
 #endif // COMMANDMANAGER_H
@@ -1,22 +1,46 @@
 #include "designarea.h"
+#include "profiler.h"
 
 #include <QMessageBox>
+#include <QtMath>
 
 
 DesignArea::DesignArea(QWidget *parent)
     : QWidget(parent), m_toolMode(ToolMode::Select),
+    m_backgroundRevision(0), m_backgroundValid(false), m_backgroundZoom(0),
+    m_zoom(1), m_viewOrigin(0, 0), m_fitPending(true), m_isPanning(false),
     m_isDrawingWall(false), m_isMovingFurniture(false),
-    m_isSelecting(false), m_rubberBand(new QRubberBand(QRubberBand::Rectangle, this))
+    m_isSelecting(false), m_rubberBand(new QRubberBand(QRubberBand::Rectangle, this)),
+    m_loadStarted(false)
 {
+#ifdef HOUSEPLANNER_PROFILING
+    m_profilerOverlay = new ProfilerOverlay(this);
+    m_profilerOverlay->hide();
+#endif
+
     setFocusPolicy(Qt::StrongFocus);
     setMouseTracking(true);
 
+    m_project.setJournal(&m_journal);
+    m_commandManager.setJournal(&m_journal);
+    connect(&m_journal, &ProjectJournal::compactionNeeded, this, [this]() {
+        m_journal.reset(m_project.data(), false);
+    });
+
+    connect(&m_loader, &ProjectLoader::started, this, &DesignArea::loadStarted);
+    connect(&m_loader, &ProjectLoader::batchLoaded, this, &DesignArea::loadBatch);
+    connect(&m_loader, &ProjectLoader::progressChanged, this, &DesignArea::loadProgressChanged);
+    connect(&m_loader, &ProjectLoader::finished, this, &DesignArea::loadFinished);
+
     // Initialize with medium house project
     newProject(Project::HouseSize::Medium);
 }
 
 DesignArea::~DesignArea()
 {
+    m_project.setJournal(nullptr);
+    m_commandManager.setJournal(nullptr);
+
     delete m_rubberBand;
 
     for (Furniture *item : m_clipboardFurniture) {
@@ -34,7 +58,6 @@ void DesignArea::setToolMode(ToolMode mode)
         }
 
         setCursor(m_toolMode == ToolMode::DrawWall ? Qt::CrossCursor : Qt::ArrowCursor);
-        update();
     }
 }
 
@@ -55,12 +78,60 @@ bool DesignArea::canRedo() const
 
 QSize DesignArea::sizeHint() const
 {
-    return m_project.getCanvasSize();
+    return m_project.getCanvasSize().boundedTo(QSize(800, 600));
 }
 
 QSize DesignArea::minimumSizeHint() const
 {
-    return m_project.getCanvasSize();
+    return QSize(200, 150);
+}
+
+qreal DesignArea::zoom() const
+{
+    return m_zoom;
+}
+
+void DesignArea::setZoom(qreal zoom, const QPointF &anchor)
+{
+    // Keep the world point under the anchor fixed on screen
+    QPointF worldAnchor = mapToWorld(anchor);
+
+    m_zoom = qBound(MIN_ZOOM, zoom, MAX_ZOOM);
+    setViewOrigin(worldAnchor - anchor / m_zoom);
+
+    emit zoomChanged(m_zoom);
+}
+
+void DesignArea::zoomIn()
+{
+    setZoom(m_zoom * ZOOM_STEP, QPointF(rect().center()));
+}
+
+void DesignArea::zoomOut()
+{
+    setZoom(m_zoom / ZOOM_STEP, QPointF(rect().center()));
+}
+
+void DesignArea::fitToView()
+{
+    // The widget has no meaningful size until it is shown
+    if (!isVisible()) {
+        m_fitPending = true;
+        return;
+    }
+
+    m_fitPending = false;
+
+    const int FIT_MARGIN = 20;
+    QSizeF canvas = m_project.getCanvasSize();
+    qreal fitZoom = qMin((width() - 2 * FIT_MARGIN) / canvas.width(),
+                         (height() - 2 * FIT_MARGIN) / canvas.height());
+
+    // Plans that already fit are shown at their real size
+    m_zoom = qBound(MIN_ZOOM, qMin<qreal>(fitZoom, 1), MAX_ZOOM);
+    setViewOrigin(QPointF(canvas.width() / 2, canvas.height() / 2) - QPointF(width() / 2.0, height() / 2.0) / m_zoom);
+
+    emit zoomChanged(m_zoom);
 }
 
 void DesignArea::deleteSelection()
@@ -68,14 +139,13 @@ void DesignArea::deleteSelection()
     if (m_selectedFurniture.isEmpty() && m_selectedWallIndices.isEmpty()) return;
 
     m_commandManager.execute(new DeleteSelectionCommand(
-        m_project.furniture(), m_selectedFurniture,
-        m_project.walls(), m_selectedWallIndices
+        m_project, m_selectedFurniture, m_selectedWallIndices
     ));
 
     m_selectedFurniture.clear();
     m_selectedWallIndices.clear();
 
-    update();
+    updateDirtyRegion();
     emit projectModified();
 }
 
@@ -83,11 +153,11 @@ void DesignArea::clearSelection()
 {
     for (Furniture *item : m_selectedFurniture) {
         item->setSelected(false);
+        updateRect(item->rotatedBoundingRect());
     }
 
     m_selectedFurniture.clear();
     clearWallSelection();
-    update();
 }
 
 void DesignArea::selectAll()
@@ -111,9 +181,9 @@ void DesignArea::deleteFurniture()
         return;
     }
 
-    m_commandManager.execute(new DeleteFurnitureCommand(m_project.furniture(), m_selectedFurniture));
+    m_commandManager.execute(new DeleteFurnitureCommand(m_project, m_selectedFurniture));
     m_selectedFurniture.clear();
-    update();
+    updateDirtyRegion();
 }
 
 bool DesignArea::hasSelectedFurniture() const
@@ -149,20 +219,42 @@ void DesignArea::pasteFurniture()
     clearSelection();
 
     const int PASTE_OFFSET = 20;
-    QPointF offset(PASTE_OFFSET, PASTE_OFFSET);
+    const int MAX_PASTE_STEPS = 50;
 
+    QList<Furniture*> newItems;
     for (Furniture *item : m_clipboardFurniture) {
         Furniture *newItem = item->clone();
-        newItem->setPosition(newItem->position() + offset);
         newItem->setSelected(true);
+        newItems.append(newItem);
+    }
 
-        ensureFurnitureInsideCanvas(newItem);
+    // The originals are usually still there, so the group is moved further
+    // along the diagonal until none of it overlaps anything
+    bool placed = false;
+    for (int step = 1; step <= MAX_PASTE_STEPS && !placed; ++step) {
+        QPointF offset(step * PASTE_OFFSET, step * PASTE_OFFSET);
+
+        for (int i = 0; i < newItems.size(); ++i) {
+            newItems[i]->setPosition(m_clipboardFurniture[i]->position() + offset);
+            ensureFurnitureInsideCanvas(newItems[i]);
+        }
 
-        m_commandManager.execute(new AddFurnitureCommand(m_project.furniture(), newItem));
-        m_selectedFurniture.append(newItem);
+        placed = findCollisions(newItems).isEmpty();
     }
 
-    update();
+    if (!placed) {
+        for (Furniture *newItem : newItems) {
+            delete newItem;
+        }
+
+        QMessageBox::information(this, tr("Paste"), tr("There is no free space near the copied furniture to paste it."));
+        return;
+    }
+
+    m_commandManager.execute(new AddFurnitureGroupCommand(m_project, newItems));
+    m_selectedFurniture = newItems;
+
+    updateDirtyRegion();
 }
 
 void DesignArea::rotateFurniture(qreal angle)
@@ -182,134 +274,353 @@ void DesignArea::rotateFurniture(qreal angle)
         return;
     }
 
-    m_commandManager.execute(new RotateFurnitureCommand(item, oldRotation, newRotation));
-    update();
+    m_commandManager.execute(new RotateFurnitureCommand(m_project, item->handle(), oldRotation, newRotation));
+    updateDirtyRegion();
 }
 
 void DesignArea::newProject(Project::HouseSize size)
 {
+    cancelLoad();
+    clearSelection();
+    m_commandManager.clear();
     m_project.newProject(size);
+    m_project.takeDirtyRegion();
+    startJournal();
+    fitToView();
+}
+
+void DesignArea::newCustomProject(const QSize &canvasSize)
+{
+    cancelLoad();
+    clearSelection();
     m_commandManager.clear();
+    m_project.newProject(canvasSize);
+    m_project.takeDirtyRegion();
+    startJournal();
+    fitToView();
+}
+
+ProjectData DesignArea::projectSnapshot() const
+{
+    return m_project.data();
+}
+
+bool DesignArea::openJournal(const QString &directory)
+{
+    return m_journal.open(directory);
+}
+
+bool DesignArea::hasRecoverableChanges() const
+{
+    return m_journal.hasRecoverableChanges();
+}
+
+bool DesignArea::recoverFromJournal()
+{
     clearSelection();
-    setFixedSize(m_project.getCanvasSize());
-    update();
+    m_commandManager.clear();
+
+    if (!m_journal.recover(m_project)) return false;
+
+    m_project.deselectAllFurniture();
+
+    m_project.takeDirtyRegion();
+    m_journal.reset(m_project.data(), false);
+    fitToView();
+
+    return true;
 }
 
-void DesignArea::saveProject(const QString &filename)
+void DesignArea::startJournal()
 {
-    if (!m_project.save(filename)) {
-        QMessageBox::warning(this, tr("Save Project"), tr("Failed to save project to %1").arg(filename));
+    if (m_journal.isOpen()) {
+        m_journal.reset(m_project.data(), true);
     }
 }
 
-void DesignArea::loadProject(const QString &filename)
+void DesignArea::rebaseJournal(const ProjectData &snapshot, bool saved)
 {
-    if (!m_project.load(filename)) {
-        QMessageBox::warning(this, tr("Load Project"), tr("Failed to load project from %1").arg(filename));
-        return;
+    m_journal.reset(snapshot, saved);
+}
+
+void DesignArea::discardJournal()
+{
+    m_journal.discard();
+}
+
+#ifdef HOUSEPLANNER_PROFILING
+void DesignArea::setProfilerOverlayVisible(bool visible)
+{
+    if (visible) {
+        Profiler::instance().clear();
+        m_profilerOverlay->raise();
     }
 
-    m_commandManager.clear();
+    m_profilerOverlay->setVisible(visible);
+}
+#endif
+
+void DesignArea::loadProject(const QString &filename)
+{
+    // The current project stays until the loader has read the file header
+    m_loader.load(filename);
+}
+
+void DesignArea::cancelLoad()
+{
+    m_loader.cancel();
+}
+
+bool DesignArea::isLoading() const
+{
+    return m_loader.isLoading();
+}
+
+void DesignArea::loadStarted(int houseSize, const QSize &canvasSize)
+{
     clearSelection();
+    m_commandManager.clear();
 
-    for (Furniture *item : m_project.furniture()) {
-        item->setSelected(false);
-    }
+    m_loadFallback = m_project.data();
+    m_loadStarted = true;
+
+    m_project.beginLoad(houseSize, canvasSize);
+    m_project.takeDirtyRegion();
+    fitToView();
+}
 
-    setFixedSize(m_project.getCanvasSize());
+void DesignArea::loadBatch(const ProjectView &batch)
+{
+    m_project.appendRecords(batch);
+    m_project.takeDirtyRegion();
     update();
 }
 
+void DesignArea::loadFinished(const QString &filename, ProjectLoader::Status status)
+{
+    if (status == ProjectLoader::Status::Loaded) {
+        m_project.finishLoad();
+    }
+    else if (m_loadStarted) {
+        m_project.setData(m_loadFallback);
+    }
+
+    bool changed = m_loadStarted;
+    m_loadFallback = ProjectData();
+    m_loadStarted = false;
+
+    if (changed) {
+        m_project.deselectAllFurniture();
+
+        m_project.takeDirtyRegion();
+        update();
+
+        // The loaded plan was fitted when it started, the view may have moved since
+        if (status != ProjectLoader::Status::Loaded) {
+            fitToView();
+        }
+    }
+
+    // A restored project is still covered by the journal as it was
+    if (status == ProjectLoader::Status::Loaded) {
+        startJournal();
+    }
+    else if (status == ProjectLoader::Status::Failed) {
+        QMessageBox::warning(this, tr("Load Project"), tr("Failed to load project from %1").arg(filename));
+    }
+
+    emit projectLoaded(filename, status == ProjectLoader::Status::Loaded);
+}
+
 void DesignArea::undo()
 {
-    m_commandManager.undo();
     clearSelection();
+    m_commandManager.undo();
 
-    for (Furniture *item : m_project.furniture()) {
-        item->setSelected(false);
-    }
+    m_project.deselectAllFurniture();
 
-    update();
+    updateDirtyRegion();
 }
 
 void DesignArea::redo()
 {
-    m_commandManager.redo();
     clearSelection();
+    m_commandManager.redo();
 
-    for (Furniture *item : m_project.furniture()) {
-        item->setSelected(false);
-    }
+    m_project.deselectAllFurniture();
 
-    update();
+    updateDirtyRegion();
 }
 
 void DesignArea::paintEvent(QPaintEvent *event)
 {
-    Q_UNUSED(event)
+    PROFILE_SCOPE(Paint);
+
+    if (!m_backgroundValid || m_backgroundRevision != m_project.wallsRevision()
+        || m_backgroundCache.devicePixelRatio() != devicePixelRatioF()
+        || m_backgroundZoom != m_zoom || !scrollBackground()) {
+        renderBackground();
+    }
+
+    QRect exposed = event->rect();
+    qreal pixelRatio = m_backgroundCache.devicePixelRatio();
 
     QPainter painter(this);
-    painter.setRenderHint(QPainter::Antialiasing);
+    painter.setClipRect(exposed);
+    painter.drawPixmap(QRectF(exposed), m_backgroundCache,
+                       QRectF(QPointF(exposed.topLeft()) * pixelRatio, QSizeF(exposed.size()) * pixelRatio));
 
-    painter.fillRect(rect(), Qt::white);
+    // Everything on top of the cached grid and walls is culled against the exposed area
+    SceneRenderer::View view = sceneView();
+    m_renderer.paintFurniture(painter, m_project, view, exposed);
+    m_renderer.paintSelection(painter, m_project, view, exposed, m_selectedWallIndices);
 
-    // Draw grid
-    painter.setPen(QPen(QColor(230, 230, 230), 1, Qt::SolidLine));
-    const int gridSize = 10;
-    for (int x = 0; x < width(); x += gridSize) {
-        painter.drawLine(x, 0, x, height());
+    if (m_isDrawingWall) {
+        m_renderer.paintWallPreview(painter, view, QLine(m_wallStartPoint, m_wallEndPoint), m_wallSnap, snapMarkerRect());
     }
-    for (int y = 0; y < height(); y += gridSize) {
-        painter.drawLine(0, y, width(), y);
+
+#ifdef HOUSEPLANNER_PROFILING
+    if (m_inputLatency.isValid()) {
+        Profiler::instance().record(Profiler::Metric::InputLatency, m_inputLatency.nsecsElapsed());
+        m_inputLatency.invalidate();
     }
+#endif
+}
 
+SceneRenderer::View DesignArea::sceneView() const
+{
+    SceneRenderer::View view;
+    view.zoom = m_zoom;
+    view.origin = m_viewOrigin;
 
-    // Draw walls
-    for (int i = 0; i < m_project.walls().size(); ++i) {
-        const Wall &wall = m_project.walls()[i];
+    return view;
+}
+
+QPointF DesignArea::mapToWorld(const QPointF &widgetPos) const
+{
+    return sceneView().mapToWorld(widgetPos);
+}
+
+void DesignArea::setViewOrigin(const QPointF &origin)
+{
+    m_viewOrigin = origin;
+    update();
+}
 
-        painter.setPen(QPen(Qt::black, 5, Qt::SolidLine, Qt::RoundCap));
-        wall.draw(painter);
+QRect DesignArea::paintRect(const QRectF &rect) const
+{
+    const int MARGIN = SceneRenderer::PAINT_MARGIN;
+    QRectF grown = rect.adjusted(-MARGIN, -MARGIN, MARGIN, MARGIN);
 
-        if (m_selectedWallIndices.contains(i)) {
-            painter.save();
-            painter.setPen(QPen(Qt::cyan, 5, Qt::SolidLine, Qt::RoundCap));
-            wall.draw(painter);
+    return sceneView().transform().mapRect(grown).toAlignedRect().adjusted(-1, -1, 1, 1);
+}
 
-            painter.setPen(QPen(Qt::black, 3, Qt::SolidLine, Qt::RoundCap));
-            wall.draw(painter);
-            painter.restore();
-        }
+void DesignArea::updateRect(const QRectF &rect)
+{
+    update(paintRect(rect));
+}
+
+void DesignArea::updateDirtyRegion()
+{
+    QRegion dirty = m_project.takeDirtyRegion();
+
+    for (const QRect &rect : dirty) {
+        update(paintRect(rect));
     }
+}
+
+void DesignArea::resizeEvent(QResizeEvent *event)
+{
+    m_backgroundValid = false;
+    QWidget::resizeEvent(event);
 
-    // Draw furniture
-    for (const Furniture *item: m_project.furniture()) {
-        item->draw(painter);
+    if (m_fitPending) {
+        fitToView();
     }
+}
 
-    // Draw wall creation
-    if (m_isDrawingWall) {
-        painter.save();
+void DesignArea::showEvent(QShowEvent *event)
+{
+    QWidget::showEvent(event);
+
+    if (m_fitPending) {
+        fitToView();
+    }
+}
+
+void DesignArea::renderBackground()
+{
+    qreal pixelRatio = devicePixelRatioF();
 
-        painter.setOpacity(0.5);
-        painter.setPen(QPen(Qt::black, 5, Qt::SolidLine, Qt::RoundCap));
-        painter.drawLine(m_wallStartPoint, m_wallEndPoint);
+    m_backgroundCache = QPixmap(size() * pixelRatio);
+    m_backgroundCache.setDevicePixelRatio(pixelRatio);
 
-        painter.restore();
+    QPainter painter(&m_backgroundCache);
+    m_renderer.paintGrid(painter, m_project, sceneView(), rect());
+    m_renderer.paintWalls(painter, m_project, sceneView(), rect());
+
+    m_backgroundRevision = m_project.wallsRevision();
+    m_backgroundValid = true;
+    m_backgroundZoom = m_zoom;
+    m_backgroundOrigin = m_viewOrigin;
+}
+
+bool DesignArea::scrollBackground()
+{
+    if (m_backgroundOrigin == m_viewOrigin) return true;
+
+    // Only whole device pixels can be scrolled, other offsets are redrawn
+    const qreal TOLERANCE = 0.01;
+    qreal pixelRatio = m_backgroundCache.devicePixelRatio();
+    QPointF shift = (m_backgroundOrigin - m_viewOrigin) * m_zoom * pixelRatio;
+    QPoint pixels = shift.toPoint();
+
+    if (qAbs(shift.x() - pixels.x()) > TOLERANCE || qAbs(shift.y() - pixels.y()) > TOLERANCE
+        || qAbs(pixels.x()) >= m_backgroundCache.width() || qAbs(pixels.y()) >= m_backgroundCache.height()) {
+        return false;
+    }
+
+    QRegion exposed;
+    m_backgroundCache.scroll(pixels.x(), pixels.y(), m_backgroundCache.rect(), &exposed);
+
+    // The origin the scrolled pixels belong to, so rounding does not add up over a drag
+    m_backgroundOrigin -= QPointF(pixels) / (m_zoom * pixelRatio);
+
+    SceneRenderer::View view = sceneView();
+    view.origin = m_backgroundOrigin;
+
+    QPainter painter(&m_backgroundCache);
+    for (const QRect &strip : exposed) {
+        QRect rect = QRectF(QPointF(strip.topLeft()) / pixelRatio, QSizeF(strip.size()) / pixelRatio).toAlignedRect();
+
+        painter.setClipRect(rect);
+        m_renderer.paintGrid(painter, m_project, view, rect);
+        m_renderer.paintWalls(painter, m_project, view, rect);
     }
+
+    return true;
 }
 
 void DesignArea::mousePressEvent(QMouseEvent *event)
 {
-    if (event->button() == Qt::LeftButton) {
+    if (m_loader.isLoading() && event->button() != Qt::MiddleButton) return;
+
+    QPointF worldPos = mapToWorld(event->pos());
+
+    if (event->button() == Qt::MiddleButton) {
+        m_isPanning = true;
+        m_lastPanPos = event->pos();
+        setCursor(Qt::ClosedHandCursor);
+    }
+    else if (event->button() == Qt::LeftButton) {
         switch (m_toolMode) {
         case ToolMode::Select:
             {
-                Furniture *furniture = getFurnitureAt(event->pos());
+                Furniture *furniture = getFurnitureAt(worldPos);
 
                 if (furniture) {
                     m_isMovingFurniture = true;
-                    m_lastMousePos = event->pos();
+                    m_lastMousePos = worldPos;
 
                     // Clear selection if ctrl is not pressed
                     if (!(event->modifiers() & Qt::ControlModifier) && !furniture->isSelected()) {
@@ -319,6 +630,7 @@ void DesignArea::mousePressEvent(QMouseEvent *event)
                     if (!furniture->isSelected()) {
                         furniture->setSelected(true);
                         m_selectedFurniture.append(furniture);
+                        updateRect(furniture->rotatedBoundingRect());
                     }
 
                     m_initialPositions.clear();
@@ -327,7 +639,7 @@ void DesignArea::mousePressEvent(QMouseEvent *event)
                     }
                 }
                 else {
-                    int wallIndex = getWallAt(event->pos());
+                    int wallIndex = getWallAt(worldPos);
 
                     if (wallIndex >= 0) {
                         if (event->modifiers() & Qt::ControlModifier) {
@@ -339,11 +651,10 @@ void DesignArea::mousePressEvent(QMouseEvent *event)
                         }
                         else {
                             clearSelection();
-                            m_selectedWallIndices.clear();
                             m_selectedWallIndices.append(wallIndex);
                         }
 
-                        update();
+                        updateRect(Project::wallBounds(m_project.walls()[wallIndex]));
                     }
                     else {
                         m_isSelecting = true;
@@ -361,18 +672,20 @@ void DesignArea::mousePressEvent(QMouseEvent *event)
         case ToolMode::DrawWall:
             {
                 m_isDrawingWall = true;
-                m_wallStartPoint = event->pos();
-                m_wallEndPoint = event->pos();
+                m_wallStartPoint = snapWallPoint(worldPos, nullptr);
+                m_wallEndPoint = m_wallStartPoint;
+                updateSnapMarker();
             }
             break;
         case ToolMode::AddChair:
             {
-                Furniture *newItem = createFurniture(FurnitureType::Chair, event->pos());
+                Furniture *newItem = createFurniture(FurnitureType::Chair, worldPos);
+                ensureFurnitureInsideCanvas(newItem);
 
                 if (!checkFurnitureCollision(newItem)) {
-                    m_commandManager.execute(new AddFurnitureCommand(m_project.furniture(), newItem));
+                    m_commandManager.execute(new AddFurnitureCommand(m_project, newItem));
                     emit projectModified();
-                    update();
+                    updateDirtyRegion();
                 }
                 else {
                     delete newItem;
@@ -381,12 +694,13 @@ void DesignArea::mousePressEvent(QMouseEvent *event)
             break;
         case ToolMode::AddSofa:
             {
-                Furniture *newItem = createFurniture(FurnitureType::Sofa, event->pos());
+                Furniture *newItem = createFurniture(FurnitureType::Sofa, worldPos);
+                ensureFurnitureInsideCanvas(newItem);
 
                 if (!checkFurnitureCollision(newItem)) {
-                    m_commandManager.execute(new AddFurnitureCommand(m_project.furniture(), newItem));
+                    m_commandManager.execute(new AddFurnitureCommand(m_project, newItem));
                     emit projectModified();
-                    update();
+                    updateDirtyRegion();
                 }
                 else {
                     delete newItem;
@@ -395,12 +709,13 @@ void DesignArea::mousePressEvent(QMouseEvent *event)
             break;
         case ToolMode::AddTable:
             {
-                Furniture *newItem = createFurniture(FurnitureType::Table, event->pos());
+                Furniture *newItem = createFurniture(FurnitureType::Table, worldPos);
+                ensureFurnitureInsideCanvas(newItem);
 
                 if (!checkFurnitureCollision(newItem)) {
-                    m_commandManager.execute(new AddFurnitureCommand(m_project.furniture(), newItem));
+                    m_commandManager.execute(new AddFurnitureCommand(m_project, newItem));
                     emit projectModified();
-                    update();
+                    updateDirtyRegion();
                 }
                 else {
                     delete newItem;
@@ -410,12 +725,12 @@ void DesignArea::mousePressEvent(QMouseEvent *event)
         case ToolMode::Rotate:
             {
                 if (m_selectedFurniture.isEmpty()){
-                    Furniture *furniture = getFurnitureAt(event->pos());
+                    Furniture *furniture = getFurnitureAt(worldPos);
                     if (furniture) {
                         clearSelection();
                         furniture->setSelected(true);
                         m_selectedFurniture.append(furniture);
-                        update();
+                        updateRect(furniture->rotatedBoundingRect());
                     }
                 }
                 else if (m_selectedFurniture.size() == 1) {
@@ -429,10 +744,33 @@ void DesignArea::mousePressEvent(QMouseEvent *event)
 
 void DesignArea::mouseMoveEvent(QMouseEvent *event)
 {
-    if (m_isDrawingWall) {
-        m_wallEndPoint = event->pos();
+#ifdef HOUSEPLANNER_PROFILING
+    // Timed from the oldest move not yet painted. Only drags always repaint.
+    if ((m_isPanning || m_isDrawingWall || m_isMovingFurniture) && !m_inputLatency.isValid()) {
+        m_inputLatency.start();
+    }
+#endif
+
+    QPointF worldPos = mapToWorld(event->pos());
+
+    if (m_isPanning) {
+        QPoint delta = event->pos() - m_lastPanPos;
+        m_lastPanPos = event->pos();
+
+        setViewOrigin(m_viewOrigin - QPointF(delta) / m_zoom);
+    }
+    else if (m_isDrawingWall) {
+        QRectF oldPreview = QRectF(QPointF(m_wallStartPoint), QPointF(m_wallEndPoint)).normalized();
+        updateSnapMarker();
 
-        if (event->modifiers() & Qt::ShiftModifier) {
+        if (!(event->modifiers() & Qt::ShiftModifier)) {
+            m_wallEndPoint = snapWallPoint(worldPos, &m_wallStartPoint);
+            updateSnapMarker();
+        }
+        else {
+            // Axis locking replaces snapping to other walls
+            m_wallSnap = WallSnapper::Result();
+            m_wallEndPoint = worldPos.toPoint();
             QPoint diff = m_wallEndPoint - m_wallStartPoint;
 
             // Horizontal snapping
@@ -445,20 +783,22 @@ void DesignArea::mouseMoveEvent(QMouseEvent *event)
             }
         }
 
-        update();
+        updateRect(oldPreview);
+        updateRect(QRectF(QPointF(m_wallStartPoint), QPointF(m_wallEndPoint)).normalized());
     }
     else if (m_isMovingFurniture) {
-        QPointF delta = event->pos() - m_lastMousePos;
-        m_lastMousePos = event->pos();
+        QPointF delta = worldPos - m_lastMousePos;
+        m_lastMousePos = worldPos;
 
         for (int i = 0; i < m_selectedFurniture.size(); ++i) {
             Furniture *item = m_selectedFurniture[i];
             item->setPosition(item->position() + delta);
 
             ensureFurnitureInsideCanvas(item);
+            m_project.updateFurnitureBounds(item);
         }
 
-        update();
+        updateDirtyRegion();
     }
     else if (m_isSelecting) {
         m_rubberBand->setGeometry(QRect(m_selectionStart, event->pos()).normalized());
@@ -467,9 +807,16 @@ void DesignArea::mouseMoveEvent(QMouseEvent *event)
 
 void DesignArea::mouseReleaseEvent(QMouseEvent *event)
 {
-    if (event->button() == Qt::LeftButton) {
+    if (event->button() == Qt::MiddleButton && m_isPanning) {
+        m_isPanning = false;
+        setCursor(m_toolMode == ToolMode::DrawWall ? Qt::CrossCursor : Qt::ArrowCursor);
+    }
+    else if (event->button() == Qt::LeftButton) {
         if (m_isDrawingWall) {
             m_isDrawingWall = false;
+            updateRect(QRectF(QPointF(m_wallStartPoint), QPointF(m_wallEndPoint)).normalized());
+            updateSnapMarker();
+            m_wallSnap = WallSnapper::Result();
 
             if ((m_wallStartPoint - m_wallEndPoint).manhattanLength() > 10) {
                 if (event->modifiers() & Qt::ShiftModifier) {
@@ -486,23 +833,23 @@ void DesignArea::mouseReleaseEvent(QMouseEvent *event)
                 }
 
                 Wall newWall(m_wallStartPoint, m_wallEndPoint);
-                m_commandManager.execute(new AddWallCommand(m_project.walls(), newWall));
+                m_commandManager.execute(new AddWallCommand(m_project, newWall));
                 emit projectModified();
             }
 
-            update();
+            updateDirtyRegion();
         }
         else if (m_isMovingFurniture) {
             m_isMovingFurniture = false;
 
             QList<QPointF> currentPositions;
-            QList<QUuid> furnitureIds;
+            QList<FurnitureHandle> furnitureHandles;
             bool positionsChanged = false;
 
             for (int i = 0; i < m_selectedFurniture.size(); ++i) {
                 Furniture *item = m_selectedFurniture[i];
                 currentPositions.append(item->position());
-                furnitureIds.append(item->id());
+                furnitureHandles.append(item->handle());
 
                 if (m_initialPositions[i] != item->position()) {
                     positionsChanged = true;
@@ -510,27 +857,21 @@ void DesignArea::mouseReleaseEvent(QMouseEvent *event)
             }
 
             if (positionsChanged) {
-                bool collisionDetected = false;
-                for (Furniture *item : m_selectedFurniture) {
-                    if (checkFurnitureCollision(item)) {
-                        collisionDetected = true;
-                        break;
-                    }
-                }
+                bool collisionDetected = !findCollisions(m_selectedFurniture).isEmpty();
 
                 if (collisionDetected) {
                     for (int i = 0; i < m_selectedFurniture.size(); ++i) {
-                        m_selectedFurniture[i]->setPosition(m_initialPositions[i]);
+                        m_project.setFurniturePosition(m_selectedFurniture[i], m_initialPositions[i]);
                     }
                 }
                 else {
-                    m_commandManager.execute(new MoveFurnitureCommand(m_project.furniture(), furnitureIds, m_initialPositions, currentPositions));
+                    m_commandManager.execute(new MoveFurnitureCommand(m_project, furnitureHandles, m_initialPositions, currentPositions));
                     emit projectModified();
                 }
             }
 
             m_initialPositions.clear();
-            update();
+            updateDirtyRegion();
         }
         else if (m_isSelecting) {
             m_isSelecting = false;
@@ -538,30 +879,59 @@ void DesignArea::mouseReleaseEvent(QMouseEvent *event)
 
             QRect selectionRect = m_rubberBand->geometry();
             if (selectionRect.width() > 5 && selectionRect.height() > 5) {
-                QList<Furniture*> itemsInRect = getFurnitureInRect(selectionRect);
+                QRectF worldRect(mapToWorld(selectionRect.topLeft()), QSizeF(selectionRect.size()) / m_zoom);
+
+                QList<Furniture*> itemsInRect = getFurnitureInRect(worldRect);
                 for (Furniture *item: itemsInRect) {
                     if (!item->isSelected()) {
                         item->setSelected(true);
                         m_selectedFurniture.append(item);
+                        updateRect(item->rotatedBoundingRect());
                     }
                 }
 
-                for (int i = 0; i < m_project.walls().size(); ++i) {
-                    if (isWallInRect(m_project.walls()[i], selectionRect)) {
+                for (int i : m_project.wallsIn(worldRect)) {
+                    if (isWallInRect(m_project.walls()[i], worldRect)) {
                         if (!m_selectedWallIndices.contains(i)) {
                             m_selectedWallIndices.append(i);
+                            updateRect(Project::wallBounds(m_project.walls()[i]));
                         }
                     }
                 }
             }
-
-            update();
         }
     }
 }
 
+void DesignArea::wheelEvent(QWheelEvent *event)
+{
+    QPoint delta = event->angleDelta();
+
+    if (event->modifiers() & Qt::ControlModifier) {
+        setZoom(m_zoom * qPow(ZOOM_STEP, delta.y() / 120.0), event->position());
+    }
+    else {
+        // Plain wheel scrolls vertically, Shift scrolls horizontally
+        QPointF scroll = (event->modifiers() & Qt::ShiftModifier) ? QPointF(delta.y(), 0) : QPointF(delta);
+        setViewOrigin(m_viewOrigin - scroll / m_zoom);
+    }
+
+    event->accept();
+}
+
 void DesignArea::keyPressEvent(QKeyEvent *event)
 {
+    if (m_loader.isLoading()) {
+        if (event->key() == Qt::Key_Escape) {
+            cancelLoad();
+        }
+        else {
+            QWidget::keyPressEvent(event);
+        }
+
+        return;
+    }
+
     switch (event->key()) {
     case Qt::Key_Delete:
         deleteSelection();
@@ -616,17 +986,45 @@ void DesignArea::keyPressEvent(QKeyEvent *event)
     }
 }
 
-int DesignArea::getWallAt(const QPoint &position)
+QPoint DesignArea::snapWallPoint(const QPointF &position, const QPoint *from)
+{
+    PROFILE_SCOPE(HitTest);
+    m_wallSnap = WallSnapper::snap(m_project, position, SNAP_DISTANCE / m_zoom, from);
+
+    return m_wallSnap.isValid() ? m_wallSnap.point : position.toPoint();
+}
+
+void DesignArea::updateSnapMarker()
 {
+    if (m_wallSnap.isValid()) {
+        updateRect(snapMarkerRect());
+    }
+}
+
+QRectF DesignArea::snapMarkerRect() const
+{
+    qreal size = SNAP_MARKER_SIZE / m_zoom;
+    return QRectF(m_wallSnap.point.x() - size, m_wallSnap.point.y() - size, 2 * size, 2 * size);
+}
+
+int DesignArea::getWallAt(const QPointF &position)
+{
+    PROFILE_SCOPE(HitTest);
     const int WALL_HIT_DISTANCE = 5;
 
-    for (int i = 0; i < m_project.walls().size(); ++i) {
+    // Hit distance is in screen pixels when zoomed out
+    qreal hitDistance = qMax<qreal>(WALL_HIT_DISTANCE, WALL_HIT_DISTANCE / m_zoom);
+    QRectF hitRect(position.x() - hitDistance, position.y() - hitDistance,
+                   2 * hitDistance, 2 * hitDistance);
+
+    // Candidates come back in ascending order, so the first hit still wins
+    for (int i : m_project.wallsIn(hitRect)) {
         const Wall &wall = m_project.walls()[i];
         QLineF line(wall.startPoint(), wall.endPoint());
 
         qreal distance = calculatePointToLineDistance(position, line);
 
-        if (distance <= WALL_HIT_DISTANCE) {
+        if (distance <= hitDistance) {
             return i;
         }
     }
@@ -635,8 +1033,13 @@ int DesignArea::getWallAt(const QPoint &position)
 }
 
 void DesignArea::clearWallSelection() {
+    for (int index : m_selectedWallIndices) {
+        if (index >= 0 && index < m_project.walls().size()) {
+            updateRect(Project::wallBounds(m_project.walls()[index]));
+        }
+    }
+
     m_selectedWallIndices.clear();
-    update();
 }
 
 void DesignArea::deleteSelectedWall() {
@@ -646,12 +1049,12 @@ void DesignArea::deleteSelectedWall() {
 
     for (int index : m_selectedWallIndices) {
         if (index >= 0 && index < m_project.walls().size()) {
-            m_commandManager.execute(new DeleteWallCommand(m_project.walls(), index));
+            m_commandManager.execute(new DeleteWallCommand(m_project, index));
         }
     }
 
     clearWallSelection();
-    update();
+    updateDirtyRegion();
 
     emit projectModified();
 }
@@ -665,7 +1068,7 @@ int DesignArea::selectedWallsCount() const
     return m_selectedWallIndices.size();
 }
 
-bool DesignArea::isWallInRect(const Wall &wall, const QRect &rect)
+bool DesignArea::isWallInRect(const Wall &wall, const QRectF &rect)
 {
     if (rect.contains(wall.startPoint()) && rect.contains(wall.endPoint())) {
         return true;
@@ -685,12 +1088,14 @@ bool DesignArea::isWallInRect(const Wall &wall, const QRect &rect)
            wallLine.intersects(rectLeft, &intersection) == QLineF::BoundedIntersection;
 }
 
-qreal DesignArea::calculatePointToLineDistance(const QPoint &point, const QLineF &line)
+qreal DesignArea::calculatePointToLineDistance(const QPointF &point, const QLineF &line)
 {
     qreal numerator = qAbs((line.y2() - line.y1()) * point.x() -
                            (line.x2() - line.x1()) * point.y() +
                            line.x2() * line.y1() - line.y2() * line.x1());
-    qreal denominator = qSqrt(qPow(line.y2() - line.y1(), 2) + qPow(line.x2() - line.x1(), 2));
+    qreal dx = line.x2() - line.x1();
+    qreal dy = line.y2() - line.y1();
+    qreal denominator = qSqrt(dx * dx + dy * dy);
 
     // Line is a point
     if (denominator == 0) {
@@ -714,25 +1119,28 @@ Furniture *DesignArea::createFurniture(FurnitureType type, const QPointF &positi
     }
 }
 
-Furniture *DesignArea::getFurnitureAt(const QPoint &position)
+Furniture *DesignArea::getFurnitureAt(const QPointF &position)
 {
-    for (int i = m_project.furniture().size() - 1; i >= 0; --i) {
-        Furniture *item = m_project.furniture()[i];
-        QRectF rect = item->rotatedBoundingRect();
+    PROFILE_SCOPE(HitTest);
+
+    // Rows come in paint order, later items are painted on top
+    const QVector<QRectF> &bounds = m_project.furnitureStore().bounds();
+    QList<int> rows = m_project.furnitureRowsIn(QRectF(position, QSizeF(0, 0)));
 
-        if (rect.contains(position)) {
-            return item;
+    for (int i = rows.size() - 1; i >= 0; --i) {
+        if (bounds[rows[i]].contains(position)) {
+            return m_project.furnitureAt(rows[i]);
         }
     }
 
     return nullptr;
 }
 
-QList<Furniture *> DesignArea::getFurnitureInRect(const QRect &rect)
+QList<Furniture *> DesignArea::getFurnitureInRect(const QRectF &rect)
 {
     QList<Furniture*> result;
-    for (Furniture *item : m_project.furniture()) {
-        if (rect.intersects(item->rotatedBoundingRect().toRect())) {
+    for (Furniture *item : m_project.furnitureIn(rect)) {
+        if (rect.intersects(item->rotatedBoundingRect())) {
             result.append(item);
         }
     }
@@ -742,11 +1150,15 @@ QList<Furniture *> DesignArea::getFurnitureInRect(const QRect &rect)
 
 bool DesignArea::checkFurnitureCollision(const Furniture *furniture) const
 {
-    if (furniture->collidesWith(m_project.walls())) {
+    PROFILE_SCOPE(Collision);
+
+    QRectF rect = furniture->rotatedBoundingRect();
+
+    if (m_project.anyWallIntersects(rect)) {
         return true;
     }
 
-    for (const Furniture *item : m_project.furniture()) {
+    for (const Furniture *item : m_project.furnitureIn(rect)) {
         if (furniture != item && furniture->collidesWith(item)) {
             return true;
         }
@@ -755,9 +1167,17 @@ bool DesignArea::checkFurnitureCollision(const Furniture *furniture) const
     return false;
 }
 
+QList<Furniture *> DesignArea::findCollisions(const QList<Furniture *> &items) const
+{
+    PROFILE_SCOPE(Collision);
+
+    return m_project.findCollisions(items);
+}
+
 void DesignArea::ensureFurnitureInsideCanvas(Furniture *furniture)
 {
-    QRectF canvasRect(0, 0, width(), height());
+    // Clamp to the plan, which can be much larger than the visible viewport
+    QSize canvas = m_project.getCanvasSize();
     QRectF itemRect = furniture->rotatedBoundingRect();
 
     QPointF newPos = furniture->position();
@@ -766,16 +1186,16 @@ void DesignArea::ensureFurnitureInsideCanvas(Furniture *furniture)
         newPos.setX(newPos.x() - itemRect.left());
     }
 
-    if (itemRect.right() > width()) {
-        newPos.setX(newPos.x() - (itemRect.right() - width()));
+    if (itemRect.right() > canvas.width()) {
+        newPos.setX(newPos.x() - (itemRect.right() - canvas.width()));
     }
 
     if (itemRect.top() < 0) {
         newPos.setY(newPos.y() - itemRect.top());
     }
 
-    if (itemRect.bottom() > height()) {
-        newPos.setY(newPos.y() - (itemRect.bottom() - height()));
+    if (itemRect.bottom() > canvas.height()) {
+        newPos.setY(newPos.y() - (itemRect.bottom() - canvas.height()));
     }
 
     furniture->setPosition(newPos);
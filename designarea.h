@@ -2,11 +2,21 @@
 #define DESIGNAREA_H
 
 #include "commandmanager.h"
+#include "profileroverlay.h"
 #include "project.h"
+#include "projectjournal.h"
+#include "projectloader.h"
+#include "scenerenderer.h"
+#include "wallsnapper.h"
+#include <QElapsedTimer>
 #include <QKeyEvent>
 #include <QMouseEvent>
 #include <QPaintEvent>
+#include <QPixmap>
+#include <QResizeEvent>
 #include <QRubberBand>
+#include <QShowEvent>
+#include <QWheelEvent>
 #include <QWidget>
 
 enum class ToolMode {
@@ -51,36 +61,114 @@ public:
 
     void rotateFurniture(qreal angle);
 
+    qreal zoom() const;
+    void setZoom(qreal zoom, const QPointF &anchor);
+
+    // Copy of everything that gets saved, safe to hand to another thread
+    ProjectData projectSnapshot() const;
+
+    // Only panning and zooming work while a project is being loaded
+    bool isLoading() const;
+
+    // Crash recovery. Nothing is journaled until startJournal(),
+    // recoverFromJournal() or a new or loaded project.
+    bool openJournal(const QString &directory);
+    bool hasRecoverableChanges() const;
+    bool recoverFromJournal();
+    void startJournal();
+    void rebaseJournal(const ProjectData &snapshot, bool saved);
+    void discardJournal();
+
+#ifdef HOUSEPLANNER_PROFILING
+    // Paint, input latency, hit-test and collision timings over the canvas
+    void setProfilerOverlayVisible(bool visible);
+#endif
+
 signals:
     void projectModified();
+    void zoomChanged(qreal zoom);
+    void loadProgressChanged(int percent);
+    void projectLoaded(const QString &filename, bool success);
 
 public slots:
     void newProject(Project::HouseSize size);
-    void saveProject(const QString &filename);
+    void newCustomProject(const QSize &canvasSize);
+    // Returns right away, the project is streamed in and projectLoaded() follows
     void loadProject(const QString &filename);
+    void cancelLoad();
 
     void undo();
     void redo();
 
+    void zoomIn();
+    void zoomOut();
+    void fitToView();
+
 protected:
     void paintEvent(QPaintEvent *event) override;
     void mousePressEvent(QMouseEvent *event) override;
     void mouseMoveEvent(QMouseEvent *event) override;
     void mouseReleaseEvent(QMouseEvent *event) override;
+    void wheelEvent(QWheelEvent *event) override;
     void keyPressEvent(QKeyEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+    void showEvent(QShowEvent *event) override;
 
 private:
     ToolMode m_toolMode;
     Project m_project;
 
+    // Grid and walls, redrawn only when the walls, the zoom or the widget size
+    // change. Panning scrolls the pixmap and draws only the uncovered strips.
+    QPixmap m_backgroundCache;
+    quint64 m_backgroundRevision;
+    bool m_backgroundValid;
+    qreal m_backgroundZoom;
+    QPointF m_backgroundOrigin;
+    void renderBackground();
+    bool scrollBackground();
+
+    SceneRenderer m_renderer;
+
+    // View transform, widget = (plan - m_viewOrigin) * m_zoom
+    qreal m_zoom;
+    QPointF m_viewOrigin;
+    bool m_fitPending;
+    bool m_isPanning;
+    QPoint m_lastPanPos;
+    SceneRenderer::View sceneView() const;
+    QPointF mapToWorld(const QPointF &widgetPos) const;
+    void setViewOrigin(const QPointF &origin);
+
+    static constexpr qreal MIN_ZOOM = 0.01;
+    static constexpr qreal MAX_ZOOM = 8.0;
+    static constexpr qreal ZOOM_STEP = 1.25;
+
+    // Partial repaints, plan rects are grown to cover pen widths and antialiasing
+    QRect paintRect(const QRectF &rect) const;
+    void updateRect(const QRectF &rect);
+    void updateDirtyRegion();
+
     bool m_isDrawingWall;
     QPoint m_wallStartPoint;
     QPoint m_wallEndPoint;
-    int getWallAt(const QPoint &position);
+
+    // Current snap target of the wall tool, radius and marker size are in screen pixels
+    WallSnapper::Result m_wallSnap;
+    static constexpr int SNAP_DISTANCE = 10;
+    static constexpr int SNAP_MARKER_SIZE = 5;
+    QPoint snapWallPoint(const QPointF &position, const QPoint *from);
+    QRectF snapMarkerRect() const;
+    void updateSnapMarker();
+
+    void loadStarted(int houseSize, const QSize &canvasSize);
+    void loadBatch(const ProjectView &batch);
+    void loadFinished(const QString &filename, ProjectLoader::Status status);
+    int getWallAt(const QPointF &position);
     int selectedWallsCount() const;
-    bool isWallInRect(const Wall &wall, const QRect &rect);
+    bool isWallInRect(const Wall &wall, const QRectF &rect);
     QList<int> m_selectedWallIndices;
-    qreal calculatePointToLineDistance(const QPoint &point, const QLineF &line);
+    qreal calculatePointToLineDistance(const QPointF &point, const QLineF &line);
 
     bool m_isMovingFurniture;
     QList<Furniture*> m_selectedFurniture;
@@ -93,14 +181,26 @@ private:
 
     QList<Furniture*> m_clipboardFurniture;
 
+    ProjectJournal m_journal;
     CommandManager m_commandManager;
 
+    // What to go back to if a load is cancelled or fails halfway
+    ProjectLoader m_loader;
+    ProjectData m_loadFallback;
+    bool m_loadStarted;
+
     Furniture *createFurniture(FurnitureType type, const QPointF &position);
-    Furniture *getFurnitureAt(const QPoint &position);
+    Furniture *getFurnitureAt(const QPointF &position);
 
-    QList<Furniture*> getFurnitureInRect(const QRect &rect);
+    QList<Furniture*> getFurnitureInRect(const QRectF &rect);
     bool checkFurnitureCollision(const Furniture *furniture) const;
+    QList<Furniture*> findCollisions(const QList<Furniture*> &items) const;
     void ensureFurnitureInsideCanvas(Furniture *furniture);
+
+#ifdef HOUSEPLANNER_PROFILING
+    ProfilerOverlay *m_profilerOverlay;
+    QElapsedTimer m_inputLatency;
+#endif
 };
 
 #endif // DESIGNAREA_H
@@ -1,22 +1,33 @@
 
 #include "furniture.h"
+#include "furniturepool.h"
+#include "wallkernel.h"
+
+#include <cmath>
 
 Furniture::Furniture()
     : m_position(0, 0), m_width(0), m_height(0), m_rotation(0),
-    m_type(FurnitureType::Chair), m_selected(false)
-{
-    m_id = QUuid::createUuid();
-}
+    m_type(FurnitureType::Chair), m_selected(false), m_geometryValid(false) {}
 
 Furniture::Furniture(const QPointF &position, qreal width, qreal height, FurnitureType type)
     :m_position(position), m_width(width), m_height(height), m_rotation(0),
-    m_type(type), m_selected(false)
+    m_type(type), m_selected(false), m_geometryValid(false) {}
+
+Furniture::Furniture(const QPointF &position, FurnitureType type)
+    : Furniture(position, sizeOf(type).width(), sizeOf(type).height(), type) {}
+
+Furniture::~Furniture()
 {
-    m_id = QUuid::createUuid();
 }
 
-Furniture::~Furniture()
+void *Furniture::operator new(std::size_t size)
 {
+    return FurniturePool::instance().allocate(size);
+}
+
+void Furniture::operator delete(void *block, std::size_t size)
+{
+    FurniturePool::instance().deallocate(block, size);
 }
 
 QPointF Furniture::position() const
@@ -27,6 +38,7 @@ QPointF Furniture::position() const
 void Furniture::setPosition(const QPointF &position)
 {
     m_position = position;
+    m_geometryValid = false;
 }
 
 qreal Furniture::width() const
@@ -46,11 +58,8 @@ qreal Furniture::rotation() const
 
 void Furniture::setRotation(qreal angle)
 {
-    // 0-360 normalization.
-    while (angle < 0) angle += 360;
-    while (angle >= 360) angle -= 360;
-
-    m_rotation = angle;
+    m_rotation = normalizedRotation(angle);
+    m_geometryValid = false;
 }
 
 FurnitureType Furniture::type() const
@@ -72,9 +81,28 @@ QString Furniture::typeName() const
     }
 }
 
-QUuid Furniture::id() const
+FurnitureHandle Furniture::handle() const
+{
+    return m_handle;
+}
+
+void Furniture::setHandle(FurnitureHandle handle)
+{
+    m_handle = handle;
+}
+
+QUuid Furniture::uuid() const
 {
-    return m_id;
+    return m_uuid;
+}
+
+QUuid Furniture::ensureUuid()
+{
+    if (m_uuid.isNull()) {
+        m_uuid = QUuid::createUuid();
+    }
+
+    return m_uuid;
 }
 
 QRectF Furniture::boundingRect() const
@@ -85,18 +113,106 @@ QRectF Furniture::boundingRect() const
 
 QRectF Furniture::rotatedBoundingRect() const
 {
-    if (qFuzzyCompare(m_rotation, 0) || qFuzzyCompare(m_rotation, 360)) {
-        return boundingRect();
+    if (!m_geometryValid) {
+        updateGeometry();
+    }
+
+    return m_cachedBounds;
+}
+
+const std::array<QPointF, 4> &Furniture::corners() const
+{
+    if (!m_geometryValid) {
+        updateGeometry();
+    }
+
+    return m_cachedCorners;
+}
+
+void Furniture::updateGeometry() const
+{
+    outline(m_position, QSizeF(m_width, m_height), m_rotation, m_cachedCorners, m_cachedBounds);
+    m_geometryValid = true;
+}
+
+void Furniture::outline(const QPointF &position, const QSizeF &size, qreal rotation,
+                        std::array<QPointF, 4> &corners, QRectF &bounds)
+{
+    // x and y positions are centered to the shape
+    QRectF rect(position.x() - size.width() / 2, position.y() - size.height() / 2, size.width(), size.height());
+    corners = { rect.topLeft(), rect.topRight(), rect.bottomRight(), rect.bottomLeft() };
+    bounds = rect;
+
+    if (!qFuzzyCompare(rotation, 0) && !qFuzzyCompare(rotation, 360)) {
+        QTransform transform;
+
+        transform.translate(position.x(), position.y());
+        transform.rotate(rotation);
+        transform.translate(-position.x(), -position.y());
+
+        for (QPointF &corner : corners) {
+            corner = transform.map(corner);
+        }
+
+        qreal left = corners[0].x();
+        qreal right = left;
+        qreal top = corners[0].y();
+        qreal bottom = top;
+
+        for (const QPointF &corner : corners) {
+            left = qMin(left, corner.x());
+            right = qMax(right, corner.x());
+            top = qMin(top, corner.y());
+            bottom = qMax(bottom, corner.y());
+        }
+
+        bounds = QRectF(QPointF(left, top), QPointF(right, bottom));
+    }
+}
+
+Furniture *Furniture::create(FurnitureType type, const QPointF &position)
+{
+    switch (type) {
+    case FurnitureType::Sofa:
+        return new Sofa(position);
+    case FurnitureType::Chair:
+        return new Chair(position);
+    case FurnitureType::Table:
+        return new Table(position);
     }
 
-    QRectF rect = boundingRect();
-    QTransform transform;
+    return nullptr;
+}
+
+QSizeF Furniture::sizeOf(FurnitureType type)
+{
+    switch (type) {
+    case FurnitureType::Sofa:
+        return QSizeF(60, 20);
+    case FurnitureType::Chair:
+    case FurnitureType::Table:
+        return QSizeF(30, 30);
+    }
+
+    return QSizeF();
+}
+
+qreal Furniture::normalizedRotation(qreal angle)
+{
+    // 0-360 normalization.
+    while (angle < 0) angle += 360;
+    while (angle >= 360) angle -= 360;
 
-    transform.translate(m_position.x(), m_position.y());
-    transform.rotate(m_rotation);
-    transform.translate(-m_position.x(), -m_position.y());
+    return angle;
+}
+
+QRectF Furniture::rotatedBoundsOf(const QPointF &position, const QSizeF &size, qreal rotation)
+{
+    std::array<QPointF, 4> corners;
+    QRectF bounds;
+    outline(position, size, normalizedRotation(rotation), corners, bounds);
 
-    return transform.mapRect(rect);
+    return bounds;
 }
 
 bool Furniture::isSelected() const
@@ -138,24 +254,94 @@ void Furniture::draw(QPainter &painter) const
     painter.restore();
 }
 
-bool Furniture::collidesWith(const Furniture *other) const
+// Separating-axis test for two convex quads; touching edges do not overlap
+static bool quadsOverlap(const std::array<QPointF, 4> &a, const std::array<QPointF, 4> &b)
 {
-    if (other == this) return false;
+    const std::array<QPointF, 4> *shapes[2] = { &a, &b };
+
+    for (const std::array<QPointF, 4> *shape : shapes) {
+        // Opposite edges are parallel, two axes per rectangle are enough
+        for (int i = 0; i < 2; ++i) {
+            QPointF edge = (*shape)[i + 1] - (*shape)[i];
+            QPointF axis(-edge.y(), edge.x());
+
+            qreal minA = QPointF::dotProduct(a[0], axis);
+            qreal maxA = minA;
+            qreal minB = QPointF::dotProduct(b[0], axis);
+            qreal maxB = minB;
+
+            for (int j = 1; j < 4; ++j) {
+                qreal projA = QPointF::dotProduct(a[j], axis);
+                qreal projB = QPointF::dotProduct(b[j], axis);
+
+                minA = qMin(minA, projA);
+                maxA = qMax(maxA, projA);
+                minB = qMin(minB, projB);
+                maxB = qMax(maxB, projB);
+            }
+
+            if (maxA <= minB || maxB <= minA) return false;
+        }
+    }
 
-    return rotatedBoundingRect().intersects(other->rotatedBoundingRect());
+    return true;
 }
 
-bool Furniture::collidesWith(const QList<Wall> &walls) const
+// Circle against a rotated rectangle given by its corners
+static bool circleOverlapsQuad(const QPointF &center, qreal radius, const std::array<QPointF, 4> &quad)
 {
-    QRectF rect = rotatedBoundingRect();
-    for (const Wall &wall : walls) {
-        if (wall.intersects(rect)) return true;
+    QPointF uEdge = quad[1] - quad[0];
+    QPointF vEdge = quad[3] - quad[0];
+    qreal uLength = std::sqrt(QPointF::dotProduct(uEdge, uEdge));
+    qreal vLength = std::sqrt(QPointF::dotProduct(vEdge, vEdge));
+
+    if (qFuzzyIsNull(uLength) || qFuzzyIsNull(vLength)) return false;
+
+    // Closest point of the rectangle, in its own frame
+    QPointF offset = center - quad[0];
+    qreal u = qBound(qreal(0), QPointF::dotProduct(offset, uEdge) / uLength, uLength);
+    qreal v = qBound(qreal(0), QPointF::dotProduct(offset, vEdge) / vLength, vLength);
+
+    QPointF closest = quad[0] + uEdge * (u / uLength) + vEdge * (v / vLength);
+    QPointF delta = center - closest;
+
+    return QPointF::dotProduct(delta, delta) < radius * radius;
+}
+
+bool Furniture::collidesWith(const Furniture *other) const
+{
+    if (other == this) return false;
+
+    // Cheap rejection for the common case of items far apart
+    if (!rotatedBoundingRect().intersects(other->rotatedBoundingRect())) return false;
+
+    bool round = isRound();
+    bool otherRound = other->isRound();
+
+    if (round && otherRound) {
+        QPointF delta = m_position - other->m_position;
+        qreal reach = roundRadius() + other->roundRadius();
+
+        return QPointF::dotProduct(delta, delta) < reach * reach;
     }
 
-    return false;
+    if (round) {
+        return circleOverlapsQuad(m_position, roundRadius(), other->corners());
+    }
+
+    if (otherRound) {
+        return circleOverlapsQuad(other->m_position, other->roundRadius(), corners());
+    }
+
+    return quadsOverlap(corners(), other->corners());
+}
+
+bool Furniture::collidesWith(const PackedWalls &walls) const
+{
+    return walls.anyIntersects(rotatedBoundingRect());
 }
 
-bool Furniture::collidesWithAny(const QList<Furniture *> &furniture, const QList<Wall> &walls) const
+bool Furniture::collidesWithAny(const QList<Furniture *> &furniture, const PackedWalls &walls) const
 {
     if (collidesWith(walls)) {
         return true;
@@ -170,6 +356,17 @@ bool Furniture::collidesWithAny(const QList<Furniture *> &furniture, const QList
     return false;
 }
 
+bool Furniture::isRound() const
+{
+    return m_type == FurnitureType::Table;
+}
+
+qreal Furniture::roundRadius() const
+{
+    // Matches the circle drawn by Table::draw
+    return qMin(m_width, m_height) / 2;
+}
+
 QColor Furniture::getColorForType() const
 {
     switch (m_type) {
@@ -190,7 +387,7 @@ QDataStream &operator<<(QDataStream &stream, const Furniture &furniture) {
            << furniture.m_height
            << qint32(furniture.m_rotation)
            << qint32(furniture.m_type)
-           << furniture.m_id
+           << furniture.m_uuid
            << furniture.m_selected;
 
     return stream;
@@ -204,18 +401,19 @@ QDataStream &operator>>(QDataStream &stream, Furniture &furniture) {
         >> furniture.m_height
         >> rotation
         >> type
-        >> furniture.m_id
+        >> furniture.m_uuid
         >> furniture.m_selected;
 
     furniture.m_rotation = rotation;
     furniture.m_type = static_cast<FurnitureType>(type);
+    furniture.m_geometryValid = false;
 
     return stream;
 }
 
-Sofa::Sofa(): Furniture(QPointF(0, 0), 60, 20, FurnitureType::Sofa) {}
+Sofa::Sofa(): Furniture(QPointF(0, 0), FurnitureType::Sofa) {}
 
-Sofa::Sofa(const QPointF &position): Furniture(QPointF(position), 60, 20, FurnitureType::Sofa) {}
+Sofa::Sofa(const QPointF &position): Furniture(QPointF(position), FurnitureType::Sofa) {}
 
 void Sofa::draw(QPainter &painter) const {
     painter.save();
@@ -251,9 +449,9 @@ Furniture *Sofa::clone() const {
     return clone;
 }
 
-Chair::Chair(): Furniture(QPointF(0, 0), 30, 30, FurnitureType::Chair) {}
+Chair::Chair(): Furniture(QPointF(0, 0), FurnitureType::Chair) {}
 
-Chair::Chair(const QPointF &position): Furniture(QPointF(position), 30, 30, FurnitureType::Chair) {}
+Chair::Chair(const QPointF &position): Furniture(QPointF(position), FurnitureType::Chair) {}
 
 void Chair::draw(QPainter &painter) const {
     painter.save();
@@ -289,9 +487,9 @@ Furniture *Chair::clone() const {
     return clone;
 }
 
-Table::Table(): Furniture(QPointF(0, 0), 30, 30, FurnitureType::Table) {}
+Table::Table(): Furniture(QPointF(0, 0), FurnitureType::Table) {}
 
-Table::Table(const QPointF &position): Furniture(QPointF(position), 30, 30, FurnitureType::Table) {}
+Table::Table(const QPointF &position): Furniture(QPointF(position), FurnitureType::Table) {}
 
 void Table::draw(QPainter &painter) const {
     painter.save();
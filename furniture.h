@@ -1,12 +1,18 @@
 #ifndef FURNITURE_H
 #define FURNITURE_H
 
+#include "furniturehandle.h"
 #include "wall.h"
 #include <QPainter>
 #include <QPointF>
 #include <QRectF>
 #include <QUuid>
 
+#include <array>
+#include <cstddef>
+
+
+class PackedWalls;
 
 enum class FurnitureType {
     Sofa,
@@ -18,8 +24,14 @@ class Furniture {
 public:
     Furniture();
     Furniture(const QPointF &position, qreal width, qreal height, FurnitureType type);
+    // Default size for the type
+    Furniture(const QPointF &position, FurnitureType type);
     virtual ~Furniture();
 
+    // Allocated from FurniturePool; create and delete items as usual
+    static void *operator new(std::size_t size);
+    static void operator delete(void *block, std::size_t size);
+
     QPointF position() const;
     void setPosition(const QPointF &position);
 
@@ -32,35 +44,71 @@ public:
     FurnitureType type() const;
     QString typeName() const;
 
-    QUuid id() const;
+    // Assigned by the owning Project, invalid while the item is not in one
+    FurnitureHandle handle() const;
+    void setHandle(FurnitureHandle handle);
+
+    // Only created on demand, for exchanging items with other tools
+    QUuid uuid() const;
+    QUuid ensureUuid();
 
     QRectF boundingRect() const;
+
+    // Cached until the next setPosition() or setRotation()
     QRectF rotatedBoundingRect() const;
 
+    // Rotated outline: top-left, top-right, bottom-right, bottom-left
+    const std::array<QPointF, 4> &corners() const;
+
     bool isSelected() const;
     void setSelected(bool selected);
 
     virtual void draw(QPainter &painter) const;
 
+    // Exact test on the rotated outlines; tables are treated as circles
     bool collidesWith(const Furniture *other) const;
-    bool collidesWith(const QList<Wall> &walls) const;
-    bool collidesWithAny(const QList<Furniture*> &furniture, const QList<Wall> &walls) const;
+    // Walls packed once by the caller, e.g. Project::packedWalls()
+    bool collidesWith(const PackedWalls &walls) const;
+    bool collidesWithAny(const QList<Furniture*> &furniture, const PackedWalls &walls) const;
 
     friend QDataStream &operator<<(QDataStream &stream, const Furniture &furniture);
     friend QDataStream &operator>>(QDataStream &stream, Furniture &furniture);
 
     virtual Furniture *clone() const = 0;
 
+    // Null for unknown types, e.g. from a damaged file
+    static Furniture *create(FurnitureType type, const QPointF &position);
+
+    // Geometry of an item without creating one, e.g. for rows loaded straight
+    // from a file. Matches the member functions exactly.
+    static QSizeF sizeOf(FurnitureType type);
+    static qreal normalizedRotation(qreal angle);
+    static QRectF rotatedBoundsOf(const QPointF &position, const QSizeF &size, qreal rotation);
+
 protected:
     QPointF m_position;
     qreal m_width;
     qreal m_height;
     qreal m_rotation;
     FurnitureType m_type;
-    QUuid m_id;
+    FurnitureHandle m_handle;
+    QUuid m_uuid;
     bool m_selected;
 
     QColor getColorForType() const;
+
+    bool isRound() const;
+    qreal roundRadius() const;
+
+private:
+    mutable QRectF m_cachedBounds;
+    mutable std::array<QPointF, 4> m_cachedCorners;
+    mutable bool m_geometryValid;
+
+    void updateGeometry() const;
+
+    static void outline(const QPointF &position, const QSizeF &size, qreal rotation,
+                        std::array<QPointF, 4> &corners, QRectF &bounds);
 };
 
 class Sofa: public Furniture {
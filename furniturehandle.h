@@ -0,0 +1,37 @@
+#ifndef FURNITUREHANDLE_H
+#define FURNITUREHANDLE_H
+
+#include <QHashFunctions>
+#include <QtGlobal>
+
+
+// Project-local reference to a furniture item: a slot index in the low 32 bits
+// and the slot's generation in the high 32 bits, so stale handles never resolve.
+class FurnitureHandle {
+public:
+    static const quint32 MAX_GENERATION = 0xffffffffu;
+
+    FurnitureHandle() : m_value(0) {}
+    FurnitureHandle(quint32 index, quint32 generation)
+        : m_value(quint64(index) | (quint64(generation) << 32)) {}
+
+    quint32 index() const { return quint32(m_value); }
+    quint32 generation() const { return quint32(m_value >> 32); }
+    quint64 value() const { return m_value; }
+
+    // Generations start at 1, so the all-zero value is never handed out
+    bool isValid() const { return m_value != 0; }
+
+    bool operator==(const FurnitureHandle &other) const { return m_value == other.m_value; }
+    bool operator!=(const FurnitureHandle &other) const { return m_value != other.m_value; }
+
+private:
+    quint64 m_value;
+};
+
+inline size_t qHash(const FurnitureHandle &handle, size_t seed = 0) noexcept
+{
+    return qHash(handle.value(), seed);
+}
+
+#endif // FURNITUREHANDLE_H
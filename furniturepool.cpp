@@ -0,0 +1,91 @@
+#include "furniturepool.h"
+#include "furniture.h"
+
+#include <new>
+
+
+FurniturePool &FurniturePool::instance()
+{
+    // Every furniture type shares the base class layout
+    static const std::size_t alignment = alignof(std::max_align_t);
+    static FurniturePool pool((sizeof(Furniture) + alignment - 1) / alignment * alignment, BLOCKS_PER_SLAB);
+
+    return pool;
+}
+
+FurniturePool::FurniturePool(std::size_t blockSize, int blocksPerSlab)
+    : m_blockSize(qMax(blockSize, sizeof(FreeBlock))), m_blocksPerSlab(blocksPerSlab),
+    m_freeList(nullptr), m_liveCount(0) {}
+
+FurniturePool::~FurniturePool()
+{
+    for (char *slab : m_slabs) {
+        ::operator delete(slab);
+    }
+}
+
+void *FurniturePool::allocate(std::size_t size)
+{
+    if (size > m_blockSize) {
+        return ::operator new(size);
+    }
+
+    QMutexLocker locker(&m_mutex);
+
+    if (!m_freeList) {
+        addSlab();
+    }
+
+    FreeBlock *block = m_freeList;
+    m_freeList = block->next;
+    ++m_liveCount;
+
+    return block;
+}
+
+void FurniturePool::deallocate(void *block, std::size_t size)
+{
+    if (!block) return;
+
+    if (size > m_blockSize) {
+        ::operator delete(block);
+        return;
+    }
+
+    QMutexLocker locker(&m_mutex);
+
+    FreeBlock *freeBlock = static_cast<FreeBlock*>(block);
+    freeBlock->next = m_freeList;
+    m_freeList = freeBlock;
+    --m_liveCount;
+}
+
+std::size_t FurniturePool::blockSize() const
+{
+    return m_blockSize;
+}
+
+int FurniturePool::liveCount() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_liveCount;
+}
+
+int FurniturePool::capacity() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_slabs.size() * m_blocksPerSlab;
+}
+
+void FurniturePool::addSlab()
+{
+    char *slab = static_cast<char*>(::operator new(m_blockSize * m_blocksPerSlab));
+    m_slabs.append(slab);
+
+    // Thread the new blocks onto the free list, lowest address first
+    for (int i = m_blocksPerSlab - 1; i >= 0; --i) {
+        FreeBlock *block = reinterpret_cast<FreeBlock*>(slab + i * m_blockSize);
+        block->next = m_freeList;
+        m_freeList = block;
+    }
+}
@@ -0,0 +1,54 @@
+#ifndef FURNITUREPOOL_H
+#define FURNITUREPOOL_H
+
+#include <QMutex>
+#include <QVector>
+
+#include <cstddef>
+
+
+// Fixed-size block allocator behind Furniture::operator new/delete. Blocks are
+// carved out of large slabs and recycled through a free list, so cloning and
+// deleting many items (paste, undo, loading) does not go through the global heap.
+//
+// The pool only provides memory, ownership is unchanged: the Project owns the
+// items in its store, a command owns the items it has removed from the project,
+// and DesignArea owns its clipboard clones. Whoever owns an item deletes it.
+class FurniturePool {
+public:
+    static FurniturePool &instance();
+
+    // Requests larger than a block fall back to the global heap
+    void *allocate(std::size_t size);
+    void deallocate(void *block, std::size_t size);
+
+    std::size_t blockSize() const;
+    int liveCount() const;
+    int capacity() const;
+
+    FurniturePool(const FurniturePool &) = delete;
+    FurniturePool &operator=(const FurniturePool &) = delete;
+
+private:
+    FurniturePool(std::size_t blockSize, int blocksPerSlab);
+    ~FurniturePool();
+
+    struct FreeBlock {
+        FreeBlock *next;
+    };
+
+    std::size_t m_blockSize;
+    int m_blocksPerSlab;
+    QVector<char*> m_slabs;
+    FreeBlock *m_freeList;
+    int m_liveCount;
+
+    // Loading and saving may create and destroy items off the GUI thread
+    mutable QMutex m_mutex;
+
+    void addSlab();
+
+    static const int BLOCKS_PER_SLAB = 256;
+};
+
+#endif // FURNITUREPOOL_H
@@ -0,0 +1,217 @@
+#include "furniturestore.h"
+
+
+int FurnitureStore::size() const
+{
+    return m_items.size();
+}
+
+bool FurnitureStore::isEmpty() const
+{
+    return m_items.isEmpty();
+}
+
+Furniture *FurnitureStore::at(int row) const
+{
+    Furniture *&item = m_items[row];
+
+    if (!item) {
+        item = Furniture::create(m_types[row], m_positions[row]);
+        item->setRotation(m_rotations[row]);
+        item->setSelected(m_selected[row]);
+        item->setHandle(m_handles[row]);
+        --m_missingObjects;
+    }
+
+    return item;
+}
+
+bool FurnitureStore::hasObject(int row) const
+{
+    return m_items[row] != nullptr;
+}
+
+const QList<Furniture *> &FurnitureStore::items() const
+{
+    for (int row = 0; m_missingObjects > 0 && row < m_items.size(); ++row) {
+        at(row);
+    }
+
+    return m_items;
+}
+
+int FurnitureStore::indexOf(const Furniture *item) const
+{
+    if (!item || !item->handle().isValid()) return -1;
+
+    // The slot may have been reused by another item since
+    int row = rowOfSlot(item->handle().index());
+    if (row < 0 || m_items[row] != item) return -1;
+
+    return row;
+}
+
+int FurnitureStore::rowOfSlot(quint32 slot) const
+{
+    return int(slot) < m_rowBySlot.size() ? m_rowBySlot[slot] : -1;
+}
+
+void FurnitureStore::append(Furniture *item)
+{
+    insert(m_items.size(), item);
+}
+
+void FurnitureStore::insert(int row, Furniture *item)
+{
+    m_items.insert(row, item);
+    m_positions.insert(row, item->position());
+    m_sizes.insert(row, QSizeF(item->width(), item->height()));
+    m_rotations.insert(row, item->rotation());
+    m_types.insert(row, item->type());
+    m_bounds.insert(row, item->rotatedBoundingRect());
+    m_handles.insert(row, item->handle());
+    m_selected.insert(row, item->isSelected());
+
+    renumberFrom(row);
+}
+
+Furniture *FurnitureStore::takeAt(int row)
+{
+    // Whoever takes a row gets an object, even if it never had one
+    Furniture *item = at(row);
+
+    m_items.removeAt(row);
+    m_positions.remove(row);
+    m_sizes.remove(row);
+    m_rotations.remove(row);
+    m_types.remove(row);
+    m_bounds.remove(row);
+    m_handles.remove(row);
+    m_selected.remove(row);
+
+    setRow(item->handle(), -1);
+    renumberFrom(row);
+
+    return item;
+}
+
+void FurnitureStore::clear()
+{
+    m_items.clear();
+    m_missingObjects = 0;
+    m_positions.clear();
+    m_sizes.clear();
+    m_rotations.clear();
+    m_types.clear();
+    m_bounds.clear();
+    m_handles.clear();
+    m_selected.clear();
+    m_rowBySlot.clear();
+}
+
+void FurnitureStore::reserve(int count)
+{
+    m_items.reserve(count);
+    m_positions.reserve(count);
+    m_sizes.reserve(count);
+    m_rotations.reserve(count);
+    m_types.reserve(count);
+    m_bounds.reserve(count);
+    m_handles.reserve(count);
+    m_selected.reserve(count);
+}
+
+void FurnitureStore::appendRow(FurnitureHandle handle, FurnitureType type, const QPointF &position,
+                               qreal rotation, bool selected)
+{
+    QSizeF size = Furniture::sizeOf(type);
+    rotation = Furniture::normalizedRotation(rotation);
+
+    m_items.append(nullptr);
+    ++m_missingObjects;
+    m_positions.append(position);
+    m_sizes.append(size);
+    m_rotations.append(rotation);
+    m_types.append(type);
+    m_bounds.append(Furniture::rotatedBoundsOf(position, size, rotation));
+    m_handles.append(handle);
+    m_selected.append(selected);
+
+    setRow(handle, m_items.size() - 1);
+}
+
+void FurnitureStore::refresh(int row)
+{
+    const Furniture *item = m_items[row];
+    if (!item) return;
+
+    m_positions[row] = item->position();
+    m_rotations[row] = item->rotation();
+    m_bounds[row] = item->rotatedBoundingRect();
+}
+
+bool FurnitureStore::isSelected(int row) const
+{
+    const Furniture *item = m_items[row];
+
+    return item ? item->isSelected() : m_selected[row];
+}
+
+void FurnitureStore::deselectAll()
+{
+    for (int row = 0; row < m_items.size(); ++row) {
+        if (Furniture *item = m_items[row]) {
+            item->setSelected(false);
+        }
+
+        m_selected[row] = false;
+    }
+}
+
+const QVector<QPointF> &FurnitureStore::positions() const
+{
+    return m_positions;
+}
+
+const QVector<QSizeF> &FurnitureStore::sizes() const
+{
+    return m_sizes;
+}
+
+const QVector<qreal> &FurnitureStore::rotations() const
+{
+    return m_rotations;
+}
+
+const QVector<FurnitureType> &FurnitureStore::types() const
+{
+    return m_types;
+}
+
+const QVector<QRectF> &FurnitureStore::bounds() const
+{
+    return m_bounds;
+}
+
+const QVector<FurnitureHandle> &FurnitureStore::handles() const
+{
+    return m_handles;
+}
+
+void FurnitureStore::setRow(FurnitureHandle handle, int row)
+{
+    int slot = handle.index();
+    while (m_rowBySlot.size() <= slot) {
+        m_rowBySlot.append(-1);
+    }
+
+    m_rowBySlot[slot] = row;
+}
+
+void FurnitureStore::renumberFrom(int row)
+{
+    // Every row after an insert or removal shifts by one
+    for (int i = row; i < m_items.size(); ++i) {
+        setRow(m_handles[i], i);
+    }
+}
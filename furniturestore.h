@@ -0,0 +1,83 @@
+#ifndef FURNITURESTORE_H
+#define FURNITURESTORE_H
+
+#include "furniture.h"
+#include <QList>
+#include <QPointF>
+#include <QRectF>
+#include <QSizeF>
+#include <QVector>
+
+
+// Project furniture in paint order. The geometry of every item is mirrored into
+// parallel arrays, so loops over many items read contiguous memory instead of
+// following pointers. The Furniture objects stay the editable view of a row;
+// call refresh() after changing one of them.
+//
+// Rows loaded from a file start out as columns only. Their Furniture object is
+// created the first time at() asks for it, so opening a large plan does not
+// allocate and construct an object per item up front.
+class FurnitureStore {
+public:
+    int size() const;
+    bool isEmpty() const;
+
+    // Creates the row's object if it has none yet
+    Furniture *at(int row) const;
+    bool hasObject(int row) const;
+
+    // Creates every missing object; prefer at() or the columns for large plans
+    const QList<Furniture*> &items() const;
+
+    // Constant time, items are found through their project handle
+    int indexOf(const Furniture *item) const;
+    // -1 if the slot holds no row
+    int rowOfSlot(quint32 slot) const;
+
+    // Items must already carry a valid handle
+    void append(Furniture *item);
+    void insert(int row, Furniture *item);
+    Furniture *takeAt(int row);
+    void clear();
+    void reserve(int count);
+
+    // A row without an object; the handle is given to the object once it exists.
+    // The type must be a known one.
+    void appendRow(FurnitureHandle handle, FurnitureType type, const QPointF &position,
+                   qreal rotation, bool selected);
+
+    void refresh(int row);
+
+    bool isSelected(int row) const;
+    void deselectAll();
+
+    const QVector<QPointF> &positions() const;
+    const QVector<QSizeF> &sizes() const;
+    const QVector<qreal> &rotations() const;
+    const QVector<FurnitureType> &types() const;
+    const QVector<QRectF> &bounds() const;
+    const QVector<FurnitureHandle> &handles() const;
+
+private:
+    // Null for rows whose object has not been created yet
+    mutable QList<Furniture*> m_items;
+    mutable int m_missingObjects = 0;
+
+    QVector<QPointF> m_positions;
+    QVector<QSizeF> m_sizes;
+    QVector<qreal> m_rotations;
+    QVector<FurnitureType> m_types;
+    QVector<QRectF> m_bounds;
+    QVector<FurnitureHandle> m_handles;
+
+    // Only read for rows without an object, the object is authoritative otherwise
+    QVector<bool> m_selected;
+
+    // Row of every item by handle slot, -1 for free slots
+    QVector<int> m_rowBySlot;
+
+    void setRow(FurnitureHandle handle, int row);
+    void renumberFrom(int row);
+};
+
+#endif // FURNITURESTORE_H
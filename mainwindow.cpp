@@ -2,7 +2,10 @@
 #include "./ui_mainwindow.h"
 
 #include <QFileDialog>
+#include <QInputDialog>
 #include <QMessageBox>
+#include <QStandardPaths>
+#include <QTimer>
 #include <QToolBar>
 
 MainWindow::MainWindow(QWidget *parent)
@@ -13,6 +16,10 @@ MainWindow::MainWindow(QWidget *parent)
 {
     ui->setupUi(this);
 
+    m_projectSaver = new ProjectSaver(this);
+    connect(m_projectSaver, &ProjectSaver::progressChanged, this, &MainWindow::updateSaveProgress);
+    connect(m_projectSaver, &ProjectSaver::finished, this, &MainWindow::saveFinished);
+
     setupDesignArea();
     createActions();
     createMenus();
@@ -25,6 +32,12 @@ MainWindow::MainWindow(QWidget *parent)
     setWindowTitle(tr("House Planner"));
     setMinimumSize(1000, 800);
     this->setIconSize(QSize(18, 18));
+
+    // Another running instance keeps its journal, this one then goes without
+    QString journalDirectory = QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + "/journal";
+    if (m_designArea->openJournal(journalDirectory)) {
+        QTimer::singleShot(0, this, &MainWindow::offerRecovery);
+    }
 }
 
 MainWindow::~MainWindow()
@@ -62,15 +75,55 @@ void MainWindow::newLargeProject()
     updateActions();
 }
 
+void MainWindow::newCustomProject()
+{
+    bool ok = false;
+    int width = QInputDialog::getInt(this, tr("New Custom Project"), tr("Width (px):"), 5000, 100, 100000, 100, &ok);
+    if (!ok) return;
+
+    int height = QInputDialog::getInt(this, tr("New Custom Project"), tr("Height (px):"), 5000, 100, 100000, 100, &ok);
+    if (!ok) return;
+
+    m_designArea->newCustomProject(QSize(width, height));
+    m_currentFile = "";
+    m_projectModified = false;
+
+    updateStatusBar();
+    updateActions();
+}
+
 void MainWindow::openProject()
 {
     QString filename = QFileDialog::getOpenFileName(this, tr("Open Project"), "", tr("House Planner Files (*.bruh);;All Files (*)"));
 
     if (filename.isEmpty()) return;
 
+    // Streamed in the background, projectLoaded() takes over the file once it is complete
+    m_loadingFile = filename;
     m_designArea->loadProject(filename);
-    m_currentFile = filename;
-    m_projectModified = false;
+
+    updateStatusBar();
+    updateActions();
+}
+
+void MainWindow::updateLoadProgress(int percent)
+{
+    m_loadProgress->setValue(percent);
+    m_loadProgress->setVisible(m_designArea->isLoading() && percent < 100);
+}
+
+void MainWindow::projectLoaded(const QString &filename, bool success)
+{
+    if (filename == m_loadingFile) {
+        m_loadingFile = "";
+    }
+
+    if (success) {
+        m_currentFile = filename;
+        m_projectModified = false;
+    }
+
+    m_loadProgress->hide();
 
     updateStatusBar();
     updateActions();
@@ -83,10 +136,7 @@ void MainWindow::saveProject()
         return;
     }
 
-    m_designArea->saveProject(m_currentFile);
-    m_projectModified = false;
-
-    updateStatusBar();
+    startSave(m_currentFile);
 }
 
 void MainWindow::saveProjectAs()
@@ -95,13 +145,76 @@ void MainWindow::saveProjectAs()
 
     if (filename.isEmpty()) return;
 
-    m_designArea->saveProject(filename);
+    // Saves go to the new file from now on, saveFinished() switches back if writing it fails
+    m_saveAsFile = filename;
+    m_fileBeforeSaveAs = m_currentFile;
     m_currentFile = filename;
+    startSave(filename);
+}
+
+void MainWindow::startSave(const QString &filename)
+{
+    // Written in the background from a snapshot, edits made meanwhile mark the project modified again
+    ProjectData snapshot = m_designArea->projectSnapshot();
+    ProjectFormat::Encoding encoding = m_compressAction->isChecked() ? ProjectFormat::Encoding::Compressed
+                                                                     : ProjectFormat::Encoding::Plain;
+    m_projectSaver->save(filename, snapshot, encoding);
+    m_designArea->rebaseJournal(snapshot, true);
     m_projectModified = false;
 
     updateStatusBar();
 }
 
+void MainWindow::updateSaveProgress(int percent)
+{
+    // Reports from a worker can still arrive after waitForFinished() returned
+    m_saveProgress->setValue(percent);
+    m_saveProgress->setVisible(m_projectSaver->isSaving() && percent < 100);
+}
+
+void MainWindow::saveFinished(const QString &filename, bool success)
+{
+    if (filename == m_saveAsFile) {
+        // Unless another project was started or opened meanwhile
+        if (!success && m_currentFile == filename) {
+            m_currentFile = m_fileBeforeSaveAs;
+        }
+
+        m_saveAsFile = "";
+        m_fileBeforeSaveAs = "";
+    }
+
+    if (success) return;
+
+    // The journal took the snapshot as saved, it has to be offered for recovery again
+    m_designArea->rebaseJournal(m_designArea->projectSnapshot(), false);
+    m_projectModified = true;
+    updateStatusBar();
+
+    QMessageBox::warning(this, tr("Save Project"), tr("Failed to save project to %1").arg(filename));
+}
+
+void MainWindow::offerRecovery()
+{
+    if (m_designArea->hasRecoverableChanges()) {
+        QMessageBox::StandardButton ret = QMessageBox::question(this, tr("Recover Project"),
+                                                                tr("House Planner did not shut down properly.\nDo you want to recover your unsaved changes?"),
+                                                                QMessageBox::Yes | QMessageBox::No);
+
+        if (ret == QMessageBox::Yes && m_designArea->recoverFromJournal()) {
+            // Recovered work is not tied to a file until it is saved again
+            m_currentFile = "";
+            m_projectModified = true;
+
+            updateStatusBar();
+            updateActions();
+            return;
+        }
+    }
+
+    m_designArea->startJournal();
+}
+
 void MainWindow::undo()
 {
     m_designArea->undo();
@@ -227,6 +340,10 @@ void MainWindow::updateStatusBar()
         status += tr(" [modified]");
     }
 
+    if (!m_loadingFile.isEmpty()) {
+        status += tr(" (loading %1, press Esc to cancel)").arg(QFileInfo(m_loadingFile).fileName());
+    }
+
     QFont font;
     font.setFamily("Helvetica");
     font.setPixelSize(11);
@@ -236,10 +353,22 @@ void MainWindow::updateStatusBar()
     m_statusLabel->setText(status);
 }
 
+void MainWindow::updateZoomLabel(qreal zoom)
+{
+    m_zoomLabel->setText(tr("%1%").arg(qRound(zoom * 100)));
+}
+
 void MainWindow::updateActions()
 {
-    m_undoAction->setEnabled(m_designArea->canUndo());
-    m_redoAction->setEnabled(m_designArea->canRedo());
+    // A project that is still loading can be viewed but not edited or saved
+    bool loading = m_designArea->isLoading();
+    m_undoAction->setEnabled(!loading && m_designArea->canUndo());
+    m_redoAction->setEnabled(!loading && m_designArea->canRedo());
+
+    for (QAction *action : { m_saveAction, m_saveAsAction, m_cutAction, m_copyAction, m_pasteAction,
+                             m_deleteAction, m_selectAllAction, m_rotateClockwiseAction, m_rotateAntiClockwiseAction }) {
+        action->setEnabled(!loading);
+    }
 
     ToolMode mode = m_designArea->getToolMode();
     m_selectAction->setChecked(mode == ToolMode::Select);
@@ -294,6 +423,9 @@ void MainWindow::createActions()
     m_newLargeAction->setShortcut(tr("Ctrl+Shift+L"));
     connect(m_newLargeAction, &QAction::triggered, this, &MainWindow::newLargeProject);
 
+    m_newCustomAction = new QAction(tr("New Custom..."), this);
+    connect(m_newCustomAction, &QAction::triggered, this, &MainWindow::newCustomProject);
+
     m_openAction = new QAction(tr("&Open..."), this);
     m_openAction->setShortcut(tr("Ctrl+O"));
     connect(m_openAction, &QAction::triggered, this, &MainWindow::openProject);
@@ -305,6 +437,11 @@ void MainWindow::createActions()
     m_saveAsAction = new QAction(tr("Save &As..."), this);
     connect(m_saveAsAction, &QAction::triggered, this, &MainWindow::saveProjectAs);
 
+    // Much smaller files for version control and network shares. Positions
+    // and rotations are kept to 1/256, far below what the canvas shows.
+    m_compressAction = new QAction(tr("&Compress Saved Projects"), this);
+    m_compressAction->setCheckable(true);
+
     m_exitAction = new QAction(tr("E&xit"), this);
     m_exitAction->setShortcut(tr("Ctrl+Q"));
     connect(m_exitAction, &QAction::triggered, this, &MainWindow::close);
@@ -376,6 +513,25 @@ void MainWindow::createActions()
     m_rotateAction->setCheckable(true);
     connect(m_rotateAction, &QAction::triggered, this, &MainWindow::setRotateMode);
 
+    m_zoomInAction = new QAction(tr("Zoom &In"), this);
+    m_zoomInAction->setShortcut(tr("Ctrl+="));
+    connect(m_zoomInAction, &QAction::triggered, m_designArea, &DesignArea::zoomIn);
+
+    m_zoomOutAction = new QAction(tr("Zoom &Out"), this);
+    m_zoomOutAction->setShortcut(tr("Ctrl+-"));
+    connect(m_zoomOutAction, &QAction::triggered, m_designArea, &DesignArea::zoomOut);
+
+    m_fitToViewAction = new QAction(tr("&Fit to Window"), this);
+    m_fitToViewAction->setShortcut(tr("Ctrl+0"));
+    connect(m_fitToViewAction, &QAction::triggered, m_designArea, &DesignArea::fitToView);
+
+#ifdef HOUSEPLANNER_PROFILING
+    m_profilerAction = new QAction(tr("&Performance Overlay"), this);
+    m_profilerAction->setShortcut(tr("F12"));
+    m_profilerAction->setCheckable(true);
+    connect(m_profilerAction, &QAction::toggled, m_designArea, &DesignArea::setProfilerOverlayVisible);
+#endif
+
     m_newSmallAction->setIcon(tintIcon(":/resource/icons/new.png", QColor(225, 225, 225)));
     m_newMediumAction->setIcon(tintIcon(":/resource/icons/new.png", QColor(225, 225, 225)));
     m_newLargeAction->setIcon(tintIcon(":/resource/icons/new.png", QColor(225, 225, 225)));
@@ -404,10 +560,12 @@ void MainWindow::createMenus()
     newMenu->addAction(m_newSmallAction);
     newMenu->addAction(m_newMediumAction);
     newMenu->addAction(m_newLargeAction);
+    newMenu->addAction(m_newCustomAction);
 
     fileMenu->addAction(m_openAction);
     fileMenu->addAction(m_saveAction);
     fileMenu->addAction(m_saveAsAction);
+    fileMenu->addAction(m_compressAction);
     fileMenu->addSeparator();
     fileMenu->addAction(m_exitAction);
 
@@ -425,6 +583,15 @@ void MainWindow::createMenus()
     editMenu->addAction(m_rotateClockwiseAction);
     editMenu->addAction(m_rotateAntiClockwiseAction);
 
+    QMenu *viewMenu = menuBar()->addMenu(tr("&View"));
+    viewMenu->addAction(m_zoomInAction);
+    viewMenu->addAction(m_zoomOutAction);
+    viewMenu->addAction(m_fitToViewAction);
+#ifdef HOUSEPLANNER_PROFILING
+    viewMenu->addSeparator();
+    viewMenu->addAction(m_profilerAction);
+#endif
+
     QMenu *toolsMenu = menuBar()->addMenu(tr("&Tools"));
     toolsMenu->addAction(m_selectAction);
     toolsMenu->addAction(m_wallAction);
@@ -466,19 +633,37 @@ void MainWindow::createStatusBar()
 {
     m_statusLabel = new QLabel(tr("New Project"));
     statusBar()->addWidget(m_statusLabel);
+
+    m_saveProgress = new QProgressBar;
+    m_saveProgress->setRange(0, 100);
+    m_saveProgress->setMaximumWidth(150);
+    m_saveProgress->setFormat(tr("Saving %p%"));
+    m_saveProgress->hide();
+    statusBar()->addPermanentWidget(m_saveProgress);
+
+    m_loadProgress = new QProgressBar;
+    m_loadProgress->setRange(0, 100);
+    m_loadProgress->setMaximumWidth(150);
+    m_loadProgress->setFormat(tr("Loading %p%"));
+    m_loadProgress->hide();
+    statusBar()->addPermanentWidget(m_loadProgress);
+
+    m_zoomLabel = new QLabel;
+    statusBar()->addPermanentWidget(m_zoomLabel);
+    updateZoomLabel(m_designArea->zoom());
+    connect(m_designArea, &DesignArea::zoomChanged, this, &MainWindow::updateZoomLabel);
 }
 
 void MainWindow::setupDesignArea()
 {
+    // The design area is its own viewport, with zoom and pan
     m_designArea = new DesignArea(this);
-    m_scrollArea = new QScrollArea;
-    m_scrollArea->setWidget(m_designArea);
-    m_scrollArea->setWidgetResizable(false);
-    m_scrollArea->setAlignment(Qt::AlignCenter);
-    setCentralWidget(m_scrollArea);
+    setCentralWidget(m_designArea);
 
     connect(m_designArea->findChild<CommandManager*>(), &CommandManager::undoRedoStateChanged, this, &MainWindow::updateActions);
     connect(m_designArea, &DesignArea::projectModified, this, &MainWindow::setProjectModified);
+    connect(m_designArea, &DesignArea::loadProgressChanged, this, &MainWindow::updateLoadProgress);
+    connect(m_designArea, &DesignArea::projectLoaded, this, &MainWindow::projectLoaded);
 }
 
 void MainWindow::closeEvent(QCloseEvent *event)
@@ -490,7 +675,15 @@ void MainWindow::closeEvent(QCloseEvent *event)
 
         if (ret == QMessageBox::Save) {
             saveProject();
-            event->accept();
+            m_projectSaver->waitForFinished();
+
+            // Still modified if the save failed or the file dialog was cancelled
+            if (m_projectModified) {
+                event->ignore();
+            }
+            else {
+                event->accept();
+            }
         }
         else if (ret == QMessageBox::Cancel) {
             event->ignore();
@@ -499,6 +692,11 @@ void MainWindow::closeEvent(QCloseEvent *event)
             event->accept();
         }
     } else {
+        m_projectSaver->waitForFinished();
         event->accept();
     }
+
+    if (event->isAccepted()) {
+        m_designArea->discardJournal();
+    }
 }
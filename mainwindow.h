@@ -2,11 +2,12 @@
 #define MAINWINDOW_H
 
 #include "designarea.h"
+#include "projectsaver.h"
 #include <QCloseEvent>
 #include <QLabel>
 #include <QAction>
 #include <QMainWindow>
-#include <QScrollArea>
+#include <QProgressBar>
 
 QT_BEGIN_NAMESPACE
 namespace Ui { class MainWindow; }
@@ -24,6 +25,7 @@ private slots:
     void newSmallProject();
     void newMediumProject();
     void newLargeProject();
+    void newCustomProject();
     void openProject();
     void saveProject();
     void saveProjectAs();
@@ -46,6 +48,14 @@ private slots:
     void setTableMode();
     void setRotateMode();
 
+    void updateSaveProgress(int percent);
+    void saveFinished(const QString &filename, bool success);
+    void offerRecovery();
+
+    void updateLoadProgress(int percent);
+    void projectLoaded(const QString &filename, bool success);
+
+    void updateZoomLabel(qreal zoom);
     void updateStatusBar();
     void updateActions();
     void setProjectModified();
@@ -57,20 +67,22 @@ private:
     void createStatusBar();
 
     void setupDesignArea();
+    void startSave(const QString &filename);
 
     void closeEvent(QCloseEvent *event) override;
 
     Ui::MainWindow *ui;
 
     DesignArea *m_designArea;
-    QScrollArea *m_scrollArea;
 
     QAction *m_newSmallAction;
     QAction *m_newMediumAction;
     QAction *m_newLargeAction;
+    QAction *m_newCustomAction;
     QAction *m_openAction;
     QAction *m_saveAction;
     QAction *m_saveAsAction;
+    QAction *m_compressAction;
     QAction *m_exitAction;
 
     QAction *m_undoAction;
@@ -90,9 +102,25 @@ private:
     QAction *m_tableAction;
     QAction *m_rotateAction;
 
+    QAction *m_zoomInAction;
+    QAction *m_zoomOutAction;
+    QAction *m_fitToViewAction;
+#ifdef HOUSEPLANNER_PROFILING
+    QAction *m_profilerAction;
+#endif
+
     QLabel *m_statusLabel;
+    QLabel *m_zoomLabel;
+    QProgressBar *m_saveProgress;
+    QProgressBar *m_loadProgress;
+
+    ProjectSaver *m_projectSaver;
 
     QString m_currentFile;
+    QString m_loadingFile;
+    // The file a running Save As writes and the name the project had before
+    QString m_saveAsFile;
+    QString m_fileBeforeSaveAs;
     bool m_projectModified;
 };
 #endif // MAINWINDOW_H
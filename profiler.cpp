@@ -0,0 +1,66 @@
+#include "profiler.h"
+
+
+Profiler::Profiler() {}
+
+Profiler &Profiler::instance()
+{
+    static Profiler profiler;
+    return profiler;
+}
+
+const char *Profiler::name(Metric metric)
+{
+    switch (metric) {
+    case Metric::Paint:
+        return "Paint";
+    case Metric::InputLatency:
+        return "Input to frame";
+    case Metric::HitTest:
+        return "Hit test";
+    case Metric::Collision:
+        return "Collision";
+    default:
+        return "";
+    }
+}
+
+void Profiler::record(Metric metric, qint64 nanoseconds)
+{
+    Samples &samples = m_samples[int(metric)];
+
+    samples.values[samples.next] = nanoseconds;
+    samples.next = (samples.next + 1) % SAMPLE_COUNT;
+    samples.count = qMin(samples.count + 1, SAMPLE_COUNT);
+}
+
+Profiler::Stats Profiler::stats(Metric metric) const
+{
+    const Samples &samples = m_samples[int(metric)];
+    Stats stats;
+    if (samples.count == 0) return stats;
+
+    qint64 total = 0;
+    qint64 longest = 0;
+    for (int i = 0; i < samples.count; ++i) {
+        total += samples.values[i];
+        longest = qMax(longest, samples.values[i]);
+    }
+
+    int last = (samples.next + SAMPLE_COUNT - 1) % SAMPLE_COUNT;
+
+    stats.samples = samples.count;
+    stats.lastMs = samples.values[last] / 1e6;
+    stats.averageMs = total / 1e6 / samples.count;
+    stats.maxMs = longest / 1e6;
+
+    return stats;
+}
+
+void Profiler::clear()
+{
+    for (Samples &samples : m_samples) {
+        samples.count = 0;
+        samples.next = 0;
+    }
+}
@@ -0,0 +1,78 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <QElapsedTimer>
+#include <QtGlobal>
+
+#include <array>
+
+
+// Recent timings of the interactive paths, shown by the performance overlay.
+// Only used from the GUI thread, so there is no locking.
+//
+// Code is timed with PROFILE_SCOPE, which compiles to nothing unless
+// HOUSEPLANNER_PROFILING is defined (see the CMake option of the same name).
+class Profiler {
+public:
+    enum class Metric {
+        Paint,
+        InputLatency,
+        HitTest,
+        Collision
+    };
+
+    static constexpr int METRIC_COUNT = 4;
+    static constexpr int SAMPLE_COUNT = 120;
+
+    struct Stats {
+        int samples = 0;
+        qreal lastMs = 0;
+        qreal averageMs = 0;
+        qreal maxMs = 0;
+    };
+
+    static Profiler &instance();
+    static const char *name(Metric metric);
+
+    void record(Metric metric, qint64 nanoseconds);
+    // Over the last SAMPLE_COUNT samples
+    Stats stats(Metric metric) const;
+    void clear();
+
+    Profiler(const Profiler &) = delete;
+    Profiler &operator=(const Profiler &) = delete;
+
+private:
+    Profiler();
+
+    struct Samples {
+        std::array<qint64, SAMPLE_COUNT> values;
+        int count = 0;
+        int next = 0;
+    };
+
+    std::array<Samples, METRIC_COUNT> m_samples;
+};
+
+// Records the time until the end of the enclosing scope
+class ScopedTimer {
+public:
+    explicit ScopedTimer(Profiler::Metric metric) : m_metric(metric) { m_timer.start(); }
+    ~ScopedTimer() { Profiler::instance().record(m_metric, m_timer.nsecsElapsed()); }
+
+    ScopedTimer(const ScopedTimer &) = delete;
+    ScopedTimer &operator=(const ScopedTimer &) = delete;
+
+private:
+    Profiler::Metric m_metric;
+    QElapsedTimer m_timer;
+};
+
+// One per scope, e.g. PROFILE_SCOPE(HitTest);
+#ifdef HOUSEPLANNER_PROFILING
+#define PROFILE_SCOPE(metric) ScopedTimer profileScope(Profiler::Metric::metric)
+#else
+#define PROFILE_SCOPE(metric)
+#endif
+
+#endif // PROFILER_H
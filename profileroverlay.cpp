@@ -0,0 +1,67 @@
+#include "profileroverlay.h"
+#include "profiler.h"
+
+#include <QFontDatabase>
+#include <QPainter>
+
+
+ProfilerOverlay::ProfilerOverlay(QWidget *parent) : QWidget(parent)
+{
+    setAttribute(Qt::WA_TransparentForMouseEvents);
+    // Opaque, so its refreshes don't repaint the design area underneath and
+    // show up in the Paint samples
+    setAttribute(Qt::WA_OpaquePaintEvent);
+    setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+
+    QFontMetrics metrics(font());
+    int width = metrics.horizontalAdvance(QString(40, QLatin1Char('0')));
+    int height = metrics.lineSpacing() * (Profiler::METRIC_COUNT + 1);
+    setGeometry(PADDING, PADDING, width + 2 * PADDING, height + 2 * PADDING);
+
+    m_refreshTimer.setInterval(REFRESH_INTERVAL);
+    connect(&m_refreshTimer, &QTimer::timeout, this, QOverload<>::of(&QWidget::update));
+}
+
+void ProfilerOverlay::paintEvent(QPaintEvent *event)
+{
+    Q_UNUSED(event);
+
+    QPainter painter(this);
+    painter.fillRect(rect(), QColor(40, 40, 40));
+    painter.setPen(Qt::white);
+
+    QFontMetrics metrics(font());
+    int y = PADDING + metrics.ascent();
+
+    painter.drawText(PADDING, y, QString("%1 %2 %3 %4")
+                                     .arg("ms", -14).arg("last", 7).arg("avg", 7).arg("max", 7));
+
+    for (int i = 0; i < Profiler::METRIC_COUNT; ++i) {
+        Profiler::Metric metric = Profiler::Metric(i);
+        Profiler::Stats stats = Profiler::instance().stats(metric);
+        y += metrics.lineSpacing();
+
+        QString line = QString("%1").arg(Profiler::name(metric), -14);
+        if (stats.samples == 0) {
+            line += QString(" %1").arg("-", 7);
+        }
+        else {
+            line += QString(" %1 %2 %3").arg(stats.lastMs, 7, 'f', 2)
+                        .arg(stats.averageMs, 7, 'f', 2).arg(stats.maxMs, 7, 'f', 2);
+        }
+
+        painter.drawText(PADDING, y, line);
+    }
+}
+
+void ProfilerOverlay::showEvent(QShowEvent *event)
+{
+    QWidget::showEvent(event);
+    m_refreshTimer.start();
+}
+
+void ProfilerOverlay::hideEvent(QHideEvent *event)
+{
+    QWidget::hideEvent(event);
+    m_refreshTimer.stop();
+}
@@ -0,0 +1,30 @@
+#ifndef PROFILEROVERLAY_H
+#define PROFILEROVERLAY_H
+
+#include <QPaintEvent>
+#include <QTimer>
+#include <QWidget>
+
+
+// Panel in the top left corner of DesignArea with the recent timings from
+// Profiler. It is refreshed a few times a second rather than every frame, so
+// it barely shows up in the paint times it reports.
+class ProfilerOverlay : public QWidget {
+    Q_OBJECT
+
+public:
+    explicit ProfilerOverlay(QWidget *parent = nullptr);
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void showEvent(QShowEvent *event) override;
+    void hideEvent(QHideEvent *event) override;
+
+private:
+    QTimer m_refreshTimer;
+
+    static constexpr int PADDING = 6;
+    static constexpr int REFRESH_INTERVAL = 250;
+};
+
+#endif // PROFILEROVERLAY_H
@@ -1,63 +1,184 @@
 #include "project.h"
+#include "broadphase.h"
+#include "projectjournal.h"
 
 #include <QFile>
+#include <QSet>
 
+#include <algorithm>
 
-Project::Project() : m_houseSize(HouseSize::Medium) {}
+
+Project::Project() : m_houseSize(HouseSize::Medium), m_customSize(MEDIUM_WIDTH, MEDIUM_HEIGHT), m_wallsRevision(0),
+    m_journal(nullptr)
+{
+    rebuildFurnitureIndex();
+    rebuildWallIndex();
+}
 
 Project::~Project()
 {
     clear();
 }
 
-bool Project::save(const QString &filename)
+bool Project::save(const QString &filename, ProjectFormat::Encoding encoding)
+{
+    return ProjectFormat::writeFile(filename, data(), ProjectFormat::ProgressCallback(), encoding);
+}
+
+bool Project::load(const QString &filename)
 {
     QFile file(filename);
-    if (!file.open(QIODevice::WriteOnly)) return false;
+    if (!file.open(QIODevice::ReadOnly)) return false;
+
+    clear();
+
+    QByteArray head = file.peek(sizeof(ProjectFormat::FileHeader));
+    if (!ProjectFormat::isVersion2(head.constData(), head.size())) {
+        return loadVersion1(file);
+    }
+
+    // Build the model straight from the mapped record arrays, without reading
+    // the file into memory first
+    if (uchar *mapped = file.map(0, file.size())) {
+        ProjectView view;
+        bool mappedOk = ProjectFormat::view(reinterpret_cast<const char*>(mapped), file.size(), view);
+        if (mappedOk) {
+            setData(view);
+        }
+
+        file.unmap(mapped);
+        if (mappedOk) return true;
+    }
+
+    QByteArray bytes = file.readAll();
+    ProjectData data;
+    if (!ProjectFormat::read(bytes.constData(), bytes.size(), data)) return false;
 
-    QDataStream out(&file);
-    out.setVersion(QDataStream::Qt_6_0);
+    setData(data);
 
-    out << QString("HouseLayoutDesigner");
-    out << qint32(1);
+    return true;
+}
 
-    out << qint32(static_cast<int>(m_houseSize));
+ProjectData Project::data() const
+{
+    ProjectData result;
+    result.houseSize = static_cast<int>(m_houseSize);
+    result.canvasSize = getCanvasSize();
 
-    out << qint32(m_walls.size());
+    result.walls.reserve(m_walls.size());
     for (const Wall &wall : m_walls) {
-        out << wall.startPoint() << wall.endPoint();
+        result.walls.append(WallRecord{ wall.startPoint().x(), wall.startPoint().y(),
+                                        wall.endPoint().x(), wall.endPoint().y() });
     }
 
-    out << qint32(m_furniture.size());
-    for (const Furniture *item : m_furniture) {
-        out << qint32(static_cast<int>(item->type()));
-        out << item->position() << item->rotation() << item->isSelected();
+    result.furniture.reserve(m_furniture.size());
+    for (int i = 0; i < m_furniture.size(); ++i) {
+        QPointF position = m_furniture.positions()[i];
+        quint32 flags = m_furniture.isSelected(i) ? FurnitureRecord::SELECTED : 0;
+
+        result.furniture.append(FurnitureRecord{ position.x(), position.y(), m_furniture.rotations()[i],
+                                                 quint32(m_furniture.types()[i]), flags });
     }
 
-    return true;
+    return result;
 }
 
-bool Project::load(const QString &filename)
+void Project::setData(const ProjectData &data)
 {
-    QFile file(filename);
-    if (!file.open(QIODevice::ReadOnly)) return false;
+    setData(ProjectView::of(data));
+}
+
+void Project::setData(const ProjectView &view)
+{
+    beginLoad(view.houseSize, view.canvasSize);
+
+    m_walls.reserve(view.wallCount);
+    for (int i = 0; i < view.wallCount; ++i) {
+        const WallRecord &record = view.walls[i];
+        m_walls.append(Wall(QPoint(record.x1, record.y1), QPoint(record.x2, record.y2)));
+    }
+
+    // Columns only, the Furniture objects are created when first needed
+    m_furniture.reserve(view.furnitureCount);
+    m_furnitureSlots.reserve(view.furnitureCount);
+    for (int i = 0; i < view.furnitureCount; ++i) {
+        appendFurnitureRecord(view.furniture[i]);
+    }
+
+    rebuildFurnitureIndex();
+    rebuildWallIndex();
+}
 
+void Project::beginLoad(int houseSize, const QSize &canvasSize)
+{
     clear();
 
-    QDataStream in(&file);
+    m_houseSize = static_cast<HouseSize>(qBound(0, houseSize, static_cast<int>(HouseSize::Custom)));
+    if (m_houseSize == HouseSize::Custom) {
+        m_customSize = QSize(qBound(1, canvasSize.width(), MAX_CUSTOM_SIZE),
+                             qBound(1, canvasSize.height(), MAX_CUSTOM_SIZE));
+    }
+
+    rebuildFurnitureIndex();
+    rebuildWallIndex();
+}
+
+void Project::appendRecords(const ProjectView &batch)
+{
+    for (int i = 0; i < batch.wallCount; ++i) {
+        const WallRecord &record = batch.walls[i];
+        Wall wall(QPoint(record.x1, record.y1), QPoint(record.x2, record.y2));
+
+        m_walls.append(wall);
+        m_packedWalls.append(wall);
+        m_wallIndex.insert(insertWallId(m_walls.size() - 1), wall);
+    }
+
+    if (batch.wallCount > 0) {
+        ++m_wallsRevision;
+    }
+
+    for (int i = 0; i < batch.furnitureCount; ++i) {
+        int rows = m_furniture.size();
+        appendFurnitureRecord(batch.furniture[i]);
+
+        if (m_furniture.size() > rows) {
+            m_furnitureIndex.insert(m_furniture.handles().last().index(), m_furniture.bounds().last());
+        }
+    }
+}
+
+void Project::finishLoad()
+{
+    rebuildFurnitureIndex();
+    rebuildWallIndex();
+}
+
+bool Project::loadVersion1(QIODevice &device)
+{
+    QDataStream in(&device);
     in.setVersion(QDataStream::Qt_6_0);
 
     QString header;
     in >> header;
     if (header != "HouseLayoutDesigner") return false;
 
+    // The stream's own version 2 predates the chunked format and only adds
+    // the custom size
     qint32 version;
     in >> version;
-    if (version != 1) return false;
+    if (version != 1 && version != 2) return false;
 
     qint32 houseSize;
     in >> houseSize;
     m_houseSize = static_cast<HouseSize>(houseSize);
+    if (m_houseSize == HouseSize::Custom) {
+        if (version < 2) return false;
+
+        qint32 width, height;
+        in >> width >> height;
+        m_customSize = QSize(qBound(1, width, MAX_CUSTOM_SIZE), qBound(1, height, MAX_CUSTOM_SIZE));
+    }
 
     qint32 wallCount;
     in >> wallCount;
@@ -78,26 +199,19 @@ bool Project::load(const QString &filename)
         bool selected;
         in >> position >> rotation >> selected;
 
-        Furniture *item = nullptr;
-        switch (static_cast<FurnitureType>(type)) {
-        case FurnitureType::Sofa:
-            item = new Sofa(position);
-            break;
-        case FurnitureType::Chair:
-            item = new Chair(position);
-            break;
-        case FurnitureType::Table:
-            item = new Table(position);
-            break;
-        }
+        Furniture *item = createFurniture(static_cast<FurnitureType>(type), position);
 
         if (item) {
             item->setRotation(rotation);
             item->setSelected(selected);
+            attachHandle(item);
             m_furniture.append(item);
         }
     }
 
+    rebuildFurnitureIndex();
+    rebuildWallIndex();
+
     return true;
 }
 
@@ -105,10 +219,28 @@ void Project::newProject(HouseSize size)
 {
     clear();
     m_houseSize = size;
+
+    rebuildFurnitureIndex();
+    rebuildWallIndex();
+}
+
+void Project::newProject(const QSize &canvasSize)
+{
+    clear();
+    setCanvasSize(canvasSize);
+}
+
+void Project::setJournal(ProjectJournal *journal)
+{
+    m_journal = journal;
 }
 
 QSize Project::getCanvasSize() const
 {
+    if (m_houseSize == HouseSize::Custom) {
+        return m_customSize;
+    }
+
     return getSizeFromEnum(m_houseSize);
 }
 
@@ -117,14 +249,21 @@ Project::HouseSize Project::getHouseSize() const
     return m_houseSize;
 }
 
-void Project::setHouseSize(HouseSize size)
+void Project::setCanvasSize(const QSize &size)
 {
-    m_houseSize = size;
+    m_houseSize = HouseSize::Custom;
+    m_customSize = QSize(qBound(1, size.width(), MAX_CUSTOM_SIZE), qBound(1, size.height(), MAX_CUSTOM_SIZE));
+
+    rebuildFurnitureIndex();
+    rebuildWallIndex();
 }
 
-QList<Wall> &Project::walls()
+void Project::setHouseSize(HouseSize size)
 {
-    return m_walls;
+    m_houseSize = size;
+
+    rebuildFurnitureIndex();
+    rebuildWallIndex();
 }
 
 const QList<Wall> &Project::walls() const
@@ -132,28 +271,283 @@ const QList<Wall> &Project::walls() const
     return m_walls;
 }
 
-QList<Furniture *> &Project::furniture()
+const PackedWalls &Project::packedWalls() const
 {
-    return m_furniture;
+    return m_packedWalls;
 }
 
 const QList<Furniture *> &Project::furniture() const
+{
+    return m_furniture.items();
+}
+
+int Project::furnitureCount() const
+{
+    return m_furniture.size();
+}
+
+Furniture *Project::furnitureAt(int index) const
+{
+    return m_furniture.at(index);
+}
+
+const FurnitureStore &Project::furnitureStore() const
 {
     return m_furniture;
 }
 
+void Project::deselectAllFurniture()
+{
+    m_furniture.deselectAll();
+}
+
+void Project::addFurniture(Furniture *item)
+{
+    attachHandle(item);
+    m_furniture.append(item);
+
+    QRectF rect = m_furniture.bounds().last();
+    m_furnitureIndex.insert(item->handle().index(), rect);
+    markDirty(rect);
+
+    journalFurniture(JournalRecord::InsertFurniture, m_furniture.size() - 1, item);
+}
+
+void Project::insertFurniture(int index, Furniture *item)
+{
+    attachHandle(item);
+    m_furniture.insert(index, item);
+
+    QRectF rect = m_furniture.bounds()[index];
+    m_furnitureIndex.insert(item->handle().index(), rect);
+    markDirty(rect);
+
+    journalFurniture(JournalRecord::InsertFurniture, index, item);
+}
+
+Furniture *Project::takeFurnitureAt(int index)
+{
+    markDirty(m_furniture.bounds()[index]);
+
+    Furniture *item = m_furniture.takeAt(index);
+    m_furnitureIndex.remove(item->handle().index());
+    detachHandle(item);
+
+    journalFurniture(JournalRecord::RemoveFurniture, index, item);
+
+    return item;
+}
+
+int Project::indexOfFurniture(Furniture *item) const
+{
+    return m_furniture.indexOf(item);
+}
+
+Furniture *Project::furnitureByHandle(FurnitureHandle handle) const
+{
+    if (!handle.isValid() || int(handle.index()) >= m_furnitureSlots.size()) return nullptr;
+
+    const FurnitureSlot &slot = m_furnitureSlots[handle.index()];
+    if (slot.generation != handle.generation() || !slot.present) return nullptr;
+
+    int row = m_furniture.rowOfSlot(handle.index());
+    return row == -1 ? nullptr : m_furniture.at(row);
+}
+
+void Project::releaseFurniture(Furniture *item)
+{
+    FurnitureHandle handle = item->handle();
+    item->setHandle(FurnitureHandle());
+
+    if (!handle.isValid() || int(handle.index()) >= m_furnitureSlots.size()) return;
+
+    // Only a removed item may give its slot back, stale handles are ignored
+    FurnitureSlot &slot = m_furnitureSlots[handle.index()];
+    if (slot.generation != handle.generation() || slot.present) return;
+
+    freeSlot(handle.index());
+}
+
+void Project::setFurniturePosition(Furniture *item, const QPointF &position)
+{
+    item->setPosition(position);
+    updateFurnitureBounds(item);
+
+    journalFurniture(JournalRecord::MoveFurniture, m_furniture.indexOf(item), item);
+}
+
+void Project::setFurnitureRotation(Furniture *item, qreal angle)
+{
+    item->setRotation(angle);
+    updateFurnitureBounds(item);
+
+    journalFurniture(JournalRecord::RotateFurniture, m_furniture.indexOf(item), item);
+}
+
+void Project::updateFurnitureBounds(Furniture *item)
+{
+    // Items that are not part of the project (e.g. being created) are ignored
+    int index = m_furniture.indexOf(item);
+    if (index == -1) return;
+
+    markDirty(m_furniture.bounds()[index]);
+    m_furniture.refresh(index);
+
+    QRectF rect = m_furniture.bounds()[index];
+    markDirty(rect);
+
+    m_furnitureIndex.update(item->handle().index(), rect);
+}
+
+void Project::addWall(const Wall &wall)
+{
+    insertWall(m_walls.size(), wall);
+}
+
+void Project::insertWall(int index, const Wall &wall)
+{
+    markDirty(wallBounds(wall));
+
+    m_walls.insert(index, wall);
+    m_packedWalls.insert(index, wall);
+    m_wallIndex.insert(insertWallId(index), wall);
+    ++m_wallsRevision;
+
+    journalWall(JournalRecord::InsertWall, index, wall);
+}
+
+void Project::removeWallAt(int index)
+{
+    markDirty(wallBounds(m_walls[index]));
+    journalWall(JournalRecord::RemoveWall, index, m_walls[index]);
+
+    m_wallIndex.remove(removeWallId(index), m_walls[index]);
+    m_walls.removeAt(index);
+    m_packedWalls.removeAt(index);
+    ++m_wallsRevision;
+}
+
+void Project::journalFurniture(quint32 operation, int index, const Furniture *item)
+{
+    if (!m_journal || !m_journal->isRecording() || index == -1) return;
+
+    JournalRecord record = {};
+    record.operation = operation;
+    record.index = index;
+    record.furnitureType = quint32(item->type());
+    record.x = item->position().x();
+    record.y = item->position().y();
+    record.rotation = item->rotation();
+
+    m_journal->record(record);
+}
+
+void Project::journalWall(quint32 operation, int index, const Wall &wall)
+{
+    if (!m_journal || !m_journal->isRecording()) return;
+
+    JournalRecord record = {};
+    record.operation = operation;
+    record.index = index;
+    record.wall[0] = wall.startPoint().x();
+    record.wall[1] = wall.startPoint().y();
+    record.wall[2] = wall.endPoint().x();
+    record.wall[3] = wall.endPoint().y();
+
+    m_journal->record(record);
+}
+
+quint64 Project::wallsRevision() const
+{
+    return m_wallsRevision;
+}
+
+void Project::markDirty(const QRectF &rect)
+{
+    m_dirtyRegion += rect.toAlignedRect();
+}
+
+QRegion Project::takeDirtyRegion()
+{
+    QRegion region = m_dirtyRegion;
+    m_dirtyRegion = QRegion();
+
+    return region;
+}
+
+QList<Furniture *> Project::furnitureIn(const QRectF &rect) const
+{
+    QList<Furniture*> result;
+    for (int row : furnitureRowsIn(rect)) {
+        result.append(m_furniture.at(row));
+    }
+
+    return result;
+}
+
+QList<int> Project::furnitureRowsIn(const QRectF &rect) const
+{
+    QList<int> rows;
+    for (quint32 slot : m_furnitureIndex.query(rect)) {
+        rows.append(m_furniture.rowOfSlot(slot));
+    }
+
+    // The quadtree returns them in tree order, callers want paint order
+    std::sort(rows.begin(), rows.end());
+
+    return rows;
+}
+
+QList<int> Project::wallsIn(const QRectF &rect) const
+{
+    QList<int> result;
+    for (int id : m_wallIndex.query(rect)) {
+        result.append(m_wallRows[id]);
+    }
+
+    std::sort(result.begin(), result.end());
+
+    return result;
+}
+
+bool Project::anyWallIntersects(const QRectF &rect) const
+{
+    QList<int> candidates = wallsIn(rect);
+    if (candidates.isEmpty()) return false;
+
+    return m_packedWalls.anyIntersects(rect, candidates);
+}
+
 void Project::clearFurniture()
 {
-    for (Furniture *item: m_furniture) {
-        delete item;
+    // Rows that never got an object have nothing to delete
+    for (int i = 0; i < m_furniture.size(); ++i) {
+        if (m_furniture.hasObject(i)) {
+            delete m_furniture.at(i);
+        }
     }
 
     m_furniture.clear();
+    m_furnitureIndex.clear();
+
+    // Invalidate every handle still held elsewhere (e.g. by the undo history)
+    m_freeSlots.clear();
+    for (int i = m_furnitureSlots.size() - 1; i >= 0; --i) {
+        if (m_furnitureSlots[i].generation != 0) {
+            freeSlot(i);
+        }
+    }
 }
 
 void Project::clearWalls()
 {
     m_walls.clear();
+    m_packedWalls.clear();
+    m_wallIndex.clear();
+    m_wallIds.clear();
+    m_wallRows.clear();
+    m_freeWallIds.clear();
+    ++m_wallsRevision;
 }
 
 void Project::clear()
@@ -162,6 +556,11 @@ void Project::clear()
     clearWalls();
 }
 
+Furniture *Project::createFurniture(FurnitureType type, const QPointF &position)
+{
+    return Furniture::create(type, position);
+}
+
 QSize Project::getSizeFromEnum(HouseSize size)
 {
     switch(size) {
@@ -175,3 +574,207 @@ QSize Project::getSizeFromEnum(HouseSize size)
         return QSize(MEDIUM_WIDTH, MEDIUM_HEIGHT);
     }
 }
+
+QList<Furniture *> Project::findCollisions(const QList<Furniture *> &items) const
+{
+    QList<Furniture*> result;
+    if (items.isEmpty()) return result;
+
+    // Moving items first, then every stationary item near them
+    QVector<Furniture*> entries;
+    QVector<QRectF> boxes;
+    QVector<bool> active;
+    QSet<Furniture*> moving;
+    QRectF region;
+
+    for (Furniture *item : items) {
+        moving.insert(item);
+
+        QRectF rect = item->rotatedBoundingRect();
+        entries.append(item);
+        boxes.append(rect);
+        active.append(true);
+        region = region.united(rect);
+    }
+
+    // Stationary rows only get an object once a box overlap needs the exact test
+    QVector<int> rows(entries.size(), -1);
+    const QVector<QRectF> &bounds = m_furniture.bounds();
+    for (int row : furnitureRowsIn(region)) {
+        if (m_furniture.hasObject(row) && moving.contains(m_furniture.at(row))) continue;
+
+        entries.append(nullptr);
+        rows.append(row);
+        boxes.append(bounds[row]);
+        active.append(false);
+    }
+
+    auto entry = [&](int i) {
+        if (!entries[i]) {
+            entries[i] = m_furniture.at(rows[i]);
+        }
+
+        return entries[i];
+    };
+
+    QVector<bool> colliding(items.size(), false);
+
+    for (const QPair<int, int> &pair : SweepAndPrune::findPairs(boxes, active)) {
+        bool firstMoving = pair.first < items.size();
+        bool secondMoving = pair.second < items.size();
+
+        if ((!firstMoving || colliding[pair.first]) && (!secondMoving || colliding[pair.second])) {
+            continue;
+        }
+
+        if (entry(pair.first)->collidesWith(entry(pair.second))) {
+            if (firstMoving) colliding[pair.first] = true;
+            if (secondMoving) colliding[pair.second] = true;
+        }
+    }
+
+    for (int i = 0; i < items.size(); ++i) {
+        if (colliding[i] || anyWallIntersects(boxes[i])) {
+            result.append(items[i]);
+        }
+    }
+
+    return result;
+}
+
+QRectF Project::wallBounds(const Wall &wall)
+{
+    return QRectF(QPointF(wall.startPoint()), QPointF(wall.endPoint())).normalized();
+}
+
+int Project::insertWallId(int index)
+{
+    int id;
+    if (!m_freeWallIds.isEmpty()) {
+        id = m_freeWallIds.takeLast();
+    }
+    else {
+        id = m_wallRows.size();
+        m_wallRows.append(-1);
+    }
+
+    m_wallIds.insert(index, id);
+    renumberWallsFrom(index);
+
+    return id;
+}
+
+int Project::removeWallId(int index)
+{
+    int id = m_wallIds[index];
+
+    m_wallIds.remove(index);
+    m_wallRows[id] = -1;
+    m_freeWallIds.append(id);
+    renumberWallsFrom(index);
+
+    return id;
+}
+
+void Project::renumberWallsFrom(int index)
+{
+    for (int row = index; row < m_wallIds.size(); ++row) {
+        m_wallRows[m_wallIds[row]] = row;
+    }
+}
+
+void Project::appendFurnitureRecord(const FurnitureRecord &record)
+{
+    // Unknown types, e.g. from a damaged file, are skipped
+    FurnitureType type = static_cast<FurnitureType>(record.type);
+    if (Furniture::sizeOf(type).isEmpty()) return;
+
+    m_furniture.appendRow(allocateHandle(), type, QPointF(record.x, record.y), record.rotation,
+                          record.flags & FurnitureRecord::SELECTED);
+}
+
+FurnitureHandle Project::allocateHandle()
+{
+    quint32 index;
+    if (!m_freeSlots.isEmpty()) {
+        index = m_freeSlots.takeLast();
+    }
+    else {
+        // The slot list is int-indexed, so every slot fits the 32-bit handle index
+        index = m_furnitureSlots.size();
+        m_furnitureSlots.append(FurnitureSlot{false, 1});
+    }
+
+    FurnitureSlot &slot = m_furnitureSlots[index];
+    slot.present = true;
+
+    return FurnitureHandle(index, slot.generation);
+}
+
+void Project::freeSlot(quint32 index)
+{
+    // A slot whose generation ran out is retired (generation 0 matches no
+    // handle) instead of wrapping around to a generation handed out before
+    FurnitureSlot &slot = m_furnitureSlots[index];
+    slot.present = false;
+
+    if (slot.generation == FurnitureHandle::MAX_GENERATION) {
+        slot.generation = 0;
+        return;
+    }
+
+    ++slot.generation;
+    m_freeSlots.append(index);
+}
+
+void Project::attachHandle(Furniture *item)
+{
+    FurnitureHandle handle = item->handle();
+
+    // Re-inserting a removed item (undo) keeps its reserved slot
+    if (handle.isValid() && int(handle.index()) < m_furnitureSlots.size()) {
+        FurnitureSlot &slot = m_furnitureSlots[handle.index()];
+        if (slot.generation == handle.generation() && !slot.present) {
+            slot.present = true;
+            return;
+        }
+    }
+
+    item->setHandle(allocateHandle());
+}
+
+void Project::detachHandle(Furniture *item)
+{
+    FurnitureHandle handle = item->handle();
+    if (!handle.isValid() || int(handle.index()) >= m_furnitureSlots.size()) return;
+
+    FurnitureSlot &slot = m_furnitureSlots[handle.index()];
+    if (slot.generation == handle.generation()) {
+        slot.present = false;
+    }
+}
+
+void Project::rebuildFurnitureIndex()
+{
+    m_furnitureIndex.reset(QRectF(QPointF(0, 0), getCanvasSize()));
+
+    for (int i = 0; i < m_furniture.size(); ++i) {
+        m_furnitureIndex.insert(m_furniture.handles()[i].index(), m_furniture.bounds()[i]);
+    }
+}
+
+void Project::rebuildWallIndex()
+{
+    m_packedWalls.assign(m_walls);
+    m_wallIndex.rebuild(m_walls);
+    m_wallIds.resize(m_walls.size());
+    m_wallRows.resize(m_walls.size());
+    m_freeWallIds.clear();
+
+    for (int i = 0; i < m_walls.size(); ++i) {
+        m_wallIds[i] = i;
+        m_wallRows[i] = i;
+    }
+
+    ++m_wallsRevision;
+}
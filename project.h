@@ -2,8 +2,18 @@
 #define PROJECT_H
 
 #include "furniture.h"
+#include "furniturestore.h"
+#include "projectformat.h"
+#include "spatialindex.h"
+#include "wallgrid.h"
+#include "wallkernel.h"
 #include "wall.h"
+#include <QHash>
+#include <QRegion>
 #include <QString>
+#include <QVector>
+
+class ProjectJournal;
 
 
 class Project {
@@ -11,37 +21,152 @@ public:
     enum class HouseSize {
         Small,
         Medium,
-        Large
+        Large,
+        Custom
     };
 
     Project();
     ~Project();
 
-    bool save(const QString &filename);
+    // Saves in the version 2 format (version 3 when compressed); load() also
+    // reads version 1 files
+    bool save(const QString &filename, ProjectFormat::Encoding encoding = ProjectFormat::Encoding::Plain);
     bool load(const QString &filename);
 
+    // Everything that is saved, as plain records
+    ProjectData data() const;
+    void setData(const ProjectData &data);
+
+    // Records only have to stay valid for the duration of the call
+    void setData(const ProjectView &view);
+
+    // Loading in batches: an empty project of the given size, record batches
+    // that are indexed right away so they can be drawn, then a final pass
+    // that rebuilds the indices from the complete lists.
+    void beginLoad(int houseSize, const QSize &canvasSize);
+    void appendRecords(const ProjectView &batch);
+    void finishLoad();
+
     void newProject(HouseSize size);
+    void newProject(const QSize &canvasSize);
+
+    // Mutations made while a command runs are recorded for crash recovery
+    void setJournal(ProjectJournal *journal);
 
     QSize getCanvasSize() const;
     HouseSize getHouseSize() const;
     void setHouseSize(HouseSize size);
+    void setCanvasSize(const QSize &size);
 
-    QList<Wall> &walls();
     const QList<Wall> &walls() const;
-
-    QList<Furniture*> &furniture();
+    // The same walls as columns for the collision kernel, kept in step with walls()
+    const PackedWalls &packedWalls() const;
+    // Creates the Furniture object of every item that has none yet (items
+    // loaded from a file only get one when first needed). Prefer the
+    // functions below for large plans.
     const QList<Furniture*> &furniture() const;
+    int furnitureCount() const;
+    Furniture *furnitureAt(int index) const;
+    const FurnitureStore &furnitureStore() const;
+    void deselectAllFurniture();
+
+    // Mutators keep the spatial index in sync; commands go through these.
+    void addFurniture(Furniture *item);
+    void insertFurniture(int index, Furniture *item);
+    Furniture *takeFurnitureAt(int index);
+    int indexOfFurniture(Furniture *item) const;
+
+    // Null for stale handles and for items that are currently removed.
+    Furniture *furnitureByHandle(FurnitureHandle handle) const;
+
+    // Frees the handle of a removed item that its owner is about to delete.
+    void releaseFurniture(Furniture *item);
+
+    void setFurniturePosition(Furniture *item, const QPointF &position);
+    void setFurnitureRotation(Furniture *item, qreal angle);
+    void updateFurnitureBounds(Furniture *item);
+
+    void addWall(const Wall &wall);
+    void insertWall(int index, const Wall &wall);
+    void removeWallAt(int index);
+
+    // Spatial queries return candidates only, in ascending order: furniture by
+    // bounding rect (so in paint order), walls by the grid cells their segment
+    // passes through.
+    QList<Furniture*> furnitureIn(const QRectF &rect) const;
+    // The same candidates as rows of furnitureStore(), without creating objects
+    QList<int> furnitureRowsIn(const QRectF &rect) const;
+    QList<int> wallsIn(const QRectF &rect) const;
+
+    // Whether any wall crosses or lies inside the rect, same test as Wall::intersects()
+    bool anyWallIntersects(const QRectF &rect) const;
+
+    // Items from the given list that overlap a wall or any other furniture.
+    // The items do not have to be part of the project yet.
+    QList<Furniture*> findCollisions(const QList<Furniture*> &items) const;
 
     void clearFurniture();
     void clearWalls();
     void clear();
 
+    // Bumped whenever the wall list changes, so views can cache wall drawings.
+    quint64 wallsRevision() const;
+
+    // Old and new extents of everything the mutators touched since the last take.
+    void markDirty(const QRectF &rect);
+    QRegion takeDirtyRegion();
+
+    // Null for unknown types, e.g. from a damaged file
+    static Furniture *createFurniture(FurnitureType type, const QPointF &position);
+
     static QSize getSizeFromEnum(HouseSize size);
+    static QRectF wallBounds(const Wall &wall);
 
 private:
     HouseSize m_houseSize;
+    QSize m_customSize;
     QList<Wall> m_walls;
-    QList<Furniture*> m_furniture;
+    FurnitureStore m_furniture;
+
+    // Removed items keep their slot until released, so undo restores the same handle
+    struct FurnitureSlot {
+        bool present;
+        quint32 generation;
+    };
+
+    QVector<FurnitureSlot> m_furnitureSlots;
+    QVector<quint32> m_freeSlots;
+    // Keyed by handle slot, so rows without an object can be indexed
+    SpatialIndex<quint32> m_furnitureIndex;
+
+    // Walls are indexed by a stable id rather than their list index, so
+    // inserting or removing one in the middle only renumbers m_wallRows
+    WallGrid m_wallIndex;
+    QVector<int> m_wallIds;
+    QVector<int> m_wallRows;
+    QVector<int> m_freeWallIds;
+    PackedWalls m_packedWalls;
+    quint64 m_wallsRevision;
+    QRegion m_dirtyRegion;
+    ProjectJournal *m_journal;
+
+    bool loadVersion1(QIODevice &device);
+
+    void journalFurniture(quint32 operation, int index, const Furniture *item);
+    void journalWall(quint32 operation, int index, const Wall &wall);
+
+    int insertWallId(int index);
+    int removeWallId(int index);
+    void renumberWallsFrom(int index);
+
+    // Loaded rows get a handle but no object
+    void appendFurnitureRecord(const FurnitureRecord &record);
+    FurnitureHandle allocateHandle();
+    void freeSlot(quint32 index);
+    void attachHandle(Furniture *item);
+    void detachHandle(Furniture *item);
+    void rebuildFurnitureIndex();
+    void rebuildWallIndex();
 
     static const int SMALL_WIDTH = 300;
     static const int SMALL_HEIGHT = 300;
@@ -51,6 +176,8 @@ private:
 
     static const int LARGE_WIDTH = 800;
     static const int LARGE_HEIGHT = 600;
+
+    static constexpr int MAX_CUSTOM_SIZE = 100000;
 };
 
 #endif // PROJECT_H
@@ -0,0 +1,615 @@
+#include "projectformat.h"
+
+#include <QSaveFile>
+#include <QSysInfo>
+#include <QtEndian>
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+
+static_assert(sizeof(WallRecord) == 16, "WallRecord is part of the file format");
+static_assert(sizeof(FurnitureRecord) == 32, "FurnitureRecord is part of the file format");
+static_assert(sizeof(ProjectFormat::FileHeader) == 40, "FileHeader is part of the file format");
+static_assert(sizeof(ProjectFormat::ChunkEntry) == 24, "ChunkEntry is part of the file format");
+
+const char ProjectFormat::MAGIC[8] = { 'H', 'L', 'D', 'P', 'R', 'J', '2', '\0' };
+
+static const bool HOST_IS_LITTLE_ENDIAN = QSysInfo::ByteOrder == QSysInfo::LittleEndian;
+
+static void swapBytes(double &value)
+{
+    quint64 bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    bits = qbswap(bits);
+    std::memcpy(&value, &bits, sizeof(bits));
+}
+
+template <typename T>
+static void swapBytes(T &value)
+{
+    value = qbswap(value);
+}
+
+// Converts between host and file byte order, a no-op on little-endian hosts
+static void toFileOrder(ProjectFormat::FileHeader &header)
+{
+    if (HOST_IS_LITTLE_ENDIAN) return;
+
+    swapBytes(header.version);
+    swapBytes(header.headerSize);
+    swapBytes(header.houseSize);
+    swapBytes(header.canvasWidth);
+    swapBytes(header.canvasHeight);
+    swapBytes(header.chunkCount);
+    swapBytes(header.tocOffset);
+}
+
+static void toFileOrder(ProjectFormat::ChunkEntry &entry)
+{
+    if (HOST_IS_LITTLE_ENDIAN) return;
+
+    swapBytes(entry.type);
+    swapBytes(entry.recordSize);
+    swapBytes(entry.offset);
+    swapBytes(entry.count);
+}
+
+static void toFileOrder(WallRecord &record)
+{
+    swapBytes(record.x1);
+    swapBytes(record.y1);
+    swapBytes(record.x2);
+    swapBytes(record.y2);
+}
+
+static void toFileOrder(FurnitureRecord &record)
+{
+    swapBytes(record.x);
+    swapBytes(record.y);
+    swapBytes(record.rotation);
+    swapBytes(record.type);
+    swapBytes(record.flags);
+}
+
+static quint64 alignedOffset(quint64 offset)
+{
+    return (offset + 7) & ~quint64(7);
+}
+
+template <typename Record>
+static bool writeRecords(QIODevice &device, const QVector<Record> &records, qint64 &written, qint64 total,
+                         const ProjectFormat::ProgressCallback &progress)
+{
+    // Batches keep progress reports coming for large projects
+    const int batchSize = 16384;
+
+    for (int start = 0; start < records.size(); start += batchSize) {
+        int count = qMin(batchSize, records.size() - start);
+        qint64 bytes = qint64(count) * qint64(sizeof(Record));
+
+        if (HOST_IS_LITTLE_ENDIAN) {
+            if (device.write(reinterpret_cast<const char*>(records.constData() + start), bytes) != bytes) return false;
+        }
+        else {
+            for (int i = start; i < start + count; ++i) {
+                Record record = records[i];
+                toFileOrder(record);
+                if (device.write(reinterpret_cast<const char*>(&record), sizeof(Record)) != qint64(sizeof(Record))) {
+                    return false;
+                }
+            }
+        }
+
+        written += bytes;
+        if (progress) {
+            progress(written, total);
+        }
+    }
+
+    return true;
+}
+
+static bool chunkFits(qint64 size, const ProjectFormat::ChunkEntry &entry, quint64 recordSize)
+{
+    // Newer writers may append fields, older ones must at least have ours
+    if (entry.recordSize < recordSize) return false;
+    if (entry.count > quint64(std::numeric_limits<int>::max())) return false;
+
+    return entry.offset <= quint64(size) && entry.count * entry.recordSize <= quint64(size) - entry.offset;
+}
+
+template <typename Record>
+static bool readRecords(const char *data, qint64 size, const ProjectFormat::ChunkEntry &entry, QVector<Record> &records)
+{
+    if (!chunkFits(size, entry, sizeof(Record))) return false;
+
+    const char *source = data + entry.offset;
+    records.resize(int(entry.count));
+
+    if (entry.recordSize == sizeof(Record)) {
+        std::memcpy(records.data(), source, entry.count * sizeof(Record));
+    }
+    else {
+        for (int i = 0; i < records.size(); ++i) {
+            std::memcpy(&records[i], source + i * entry.recordSize, sizeof(Record));
+        }
+    }
+
+    if (!HOST_IS_LITTLE_ENDIAN) {
+        for (Record &record : records) {
+            toFileOrder(record);
+        }
+    }
+
+    return true;
+}
+
+template <typename Record>
+static bool viewRecords(const char *data, qint64 size, const ProjectFormat::ChunkEntry &entry,
+                        const Record *&records, int &count)
+{
+    if (!HOST_IS_LITTLE_ENDIAN || entry.recordSize != sizeof(Record)) return false;
+    if (!chunkFits(size, entry, sizeof(Record))) return false;
+
+    const char *source = data + entry.offset;
+    if (quintptr(source) % alignof(Record) != 0) return false;
+
+    records = reinterpret_cast<const Record*>(source);
+    count = int(entry.count);
+
+    return true;
+}
+
+// Compressed chunks, see ProjectFormat::Encoding
+static const double QUANTUM = 256.0;
+static const int COMPRESSION_LEVEL = 3;
+
+static quint64 zigzag(qint64 value)
+{
+    return (quint64(value) << 1) ^ quint64(value >> 63);
+}
+
+static qint64 unzigzag(quint64 value)
+{
+    return qint64(value >> 1) ^ -qint64(value & 1);
+}
+
+static void putVarint(QByteArray &out, quint64 value)
+{
+    while (value >= 0x80) {
+        out.append(char((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+
+    out.append(char(value));
+}
+
+static void putDelta(QByteArray &out, qint64 value, qint64 &previous)
+{
+    putVarint(out, zigzag(value - previous));
+    previous = value;
+}
+
+static qint64 quantize(double value)
+{
+    // Damaged values must not overflow the conversion
+    if (!std::isfinite(value)) return 0;
+
+    return std::llround(qBound(-1e15, value * QUANTUM, 1e15));
+}
+
+class VarintReader {
+public:
+    VarintReader(const QByteArray &bytes)
+        : m_data(reinterpret_cast<const uchar*>(bytes.constData())), m_end(m_data + bytes.size()), m_ok(true) {}
+
+    quint64 next()
+    {
+        quint64 value = 0;
+
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (m_data == m_end) break;
+
+            uchar byte = *m_data++;
+            value |= quint64(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) return value;
+        }
+
+        m_ok = false;
+        return 0;
+    }
+
+    qint64 nextDelta(qint64 &previous)
+    {
+        previous += unzigzag(next());
+        return previous;
+    }
+
+    bool isOk() const { return m_ok; }
+
+private:
+    const uchar *m_data;
+    const uchar *m_end;
+    bool m_ok;
+};
+
+static QByteArray packRecords(const QVector<WallRecord> &walls)
+{
+    QByteArray out;
+    out.reserve(walls.size() * 6 + 8);
+    putVarint(out, quint64(walls.size()));
+
+    // Walls are mostly drawn end to start and axis-aligned, so start points
+    // are relative to the previous end point and end points to their start
+    qint64 previous = 0;
+    for (const WallRecord &wall : walls) {
+        putDelta(out, wall.x1, previous);
+        previous = wall.x2;
+    }
+
+    previous = 0;
+    for (const WallRecord &wall : walls) {
+        putDelta(out, wall.y1, previous);
+        previous = wall.y2;
+    }
+
+    for (const WallRecord &wall : walls) {
+        putVarint(out, zigzag(qint64(wall.x2) - wall.x1));
+    }
+
+    for (const WallRecord &wall : walls) {
+        putVarint(out, zigzag(qint64(wall.y2) - wall.y1));
+    }
+
+    return qCompress(out, COMPRESSION_LEVEL);
+}
+
+static QByteArray packRecords(const QVector<FurnitureRecord> &furniture)
+{
+    QByteArray out;
+    out.reserve(furniture.size() * 8 + 8);
+    putVarint(out, quint64(furniture.size()));
+
+    qint64 previous = 0;
+    for (const FurnitureRecord &item : furniture) {
+        putDelta(out, quantize(item.x), previous);
+    }
+
+    previous = 0;
+    for (const FurnitureRecord &item : furniture) {
+        putDelta(out, quantize(item.y), previous);
+    }
+
+    previous = 0;
+    for (const FurnitureRecord &item : furniture) {
+        putDelta(out, quantize(item.rotation), previous);
+    }
+
+    for (const FurnitureRecord &item : furniture) {
+        putVarint(out, item.type);
+    }
+
+    for (const FurnitureRecord &item : furniture) {
+        putVarint(out, item.flags);
+    }
+
+    return qCompress(out, COMPRESSION_LEVEL);
+}
+
+static bool unpackCount(VarintReader &reader, const QByteArray &bytes, int fieldsPerRecord, int &count)
+{
+    // Every field takes at least one byte, which also bounds damaged counts
+    quint64 value = reader.next();
+    if (!reader.isOk() || value > quint64(bytes.size()) / fieldsPerRecord) return false;
+
+    count = int(value);
+    return true;
+}
+
+static bool unpackRecords(const QByteArray &packed, QVector<WallRecord> &walls)
+{
+    QByteArray bytes = qUncompress(packed);
+    VarintReader reader(bytes);
+
+    int count;
+    if (!unpackCount(reader, bytes, 4, count)) return false;
+
+    // Start points depend on the previous end point, so all columns are read first
+    QVector<qint64> startX(count), startY(count);
+    for (qint64 &value : startX) value = unzigzag(reader.next());
+    for (qint64 &value : startY) value = unzigzag(reader.next());
+
+    walls.resize(count);
+
+    qint64 endX = 0;
+    qint64 endY = 0;
+    for (int i = 0; i < count; ++i) {
+        qint64 x1 = endX + startX[i];
+        endX = x1 + unzigzag(reader.next());
+
+        walls[i].x1 = qint32(x1);
+        walls[i].x2 = qint32(endX);
+    }
+
+    for (int i = 0; i < count; ++i) {
+        qint64 y1 = endY + startY[i];
+        endY = y1 + unzigzag(reader.next());
+
+        walls[i].y1 = qint32(y1);
+        walls[i].y2 = qint32(endY);
+    }
+
+    return reader.isOk();
+}
+
+static bool unpackRecords(const QByteArray &packed, QVector<FurnitureRecord> &furniture)
+{
+    QByteArray bytes = qUncompress(packed);
+    VarintReader reader(bytes);
+
+    int count;
+    if (!unpackCount(reader, bytes, 5, count)) return false;
+
+    furniture.resize(count);
+
+    qint64 previous = 0;
+    for (FurnitureRecord &item : furniture) {
+        item.x = reader.nextDelta(previous) / QUANTUM;
+    }
+
+    previous = 0;
+    for (FurnitureRecord &item : furniture) {
+        item.y = reader.nextDelta(previous) / QUANTUM;
+    }
+
+    previous = 0;
+    for (FurnitureRecord &item : furniture) {
+        item.rotation = reader.nextDelta(previous) / QUANTUM;
+    }
+
+    for (FurnitureRecord &item : furniture) {
+        item.type = quint32(reader.next());
+    }
+
+    for (FurnitureRecord &item : furniture) {
+        item.flags = quint32(reader.next());
+    }
+
+    return reader.isOk();
+}
+
+template <typename Record>
+static bool readCompressedRecords(const char *data, qint64 size, const ProjectFormat::ChunkEntry &entry,
+                                  QVector<Record> &records)
+{
+    if (entry.recordSize != 1 || !chunkFits(size, entry, 1)) return false;
+
+    return unpackRecords(QByteArray::fromRawData(data + entry.offset, int(entry.count)), records);
+}
+
+ProjectView ProjectView::of(const ProjectData &data)
+{
+    ProjectView view;
+    view.houseSize = data.houseSize;
+    view.canvasSize = data.canvasSize;
+    view.walls = data.walls.constData();
+    view.wallCount = data.walls.size();
+    view.furniture = data.furniture.constData();
+    view.furnitureCount = data.furniture.size();
+
+    return view;
+}
+
+bool ProjectFormat::isVersion2(const char *data, qint64 size)
+{
+    return size >= qint64(sizeof(MAGIC)) && std::memcmp(data, MAGIC, sizeof(MAGIC)) == 0;
+}
+
+bool ProjectFormat::write(QIODevice &device, const ProjectData &data, const ProgressCallback &progress,
+                          Encoding encoding)
+{
+    if (encoding == Encoding::Compressed) {
+        return writeCompressed(device, data, progress);
+    }
+
+    const quint32 chunkCount = 2;
+    FileHeader header = makeHeader(data, VERSION, chunkCount);
+
+    ChunkEntry chunks[chunkCount];
+    quint64 offset = alignedOffset(header.tocOffset + chunkCount * sizeof(ChunkEntry));
+
+    chunks[0] = ChunkEntry{ WallChunk, sizeof(WallRecord), offset, quint64(data.walls.size()) };
+    offset = alignedOffset(offset + data.walls.size() * sizeof(WallRecord));
+
+    chunks[1] = ChunkEntry{ FurnitureChunk, sizeof(FurnitureRecord), offset, quint64(data.furniture.size()) };
+
+    const qint64 total = chunks[1].offset + data.furniture.size() * sizeof(FurnitureRecord);
+
+    toFileOrder(header);
+    if (device.write(reinterpret_cast<const char*>(&header), sizeof(header)) != qint64(sizeof(header))) return false;
+
+    for (ChunkEntry entry : chunks) {
+        toFileOrder(entry);
+        if (device.write(reinterpret_cast<const char*>(&entry), sizeof(entry)) != qint64(sizeof(entry))) return false;
+    }
+
+    // Padding up to each chunk's aligned offset
+    const char padding[8] = {};
+    qint64 written = sizeof(FileHeader) + chunkCount * sizeof(ChunkEntry);
+
+    if (device.write(padding, chunks[0].offset - written) < 0) return false;
+    written = chunks[0].offset;
+    if (!writeRecords(device, data.walls, written, total, progress)) return false;
+
+    if (device.write(padding, chunks[1].offset - written) < 0) return false;
+    written = chunks[1].offset;
+    if (!writeRecords(device, data.furniture, written, total, progress)) return false;
+
+    if (progress) {
+        progress(total, total);
+    }
+
+    return true;
+}
+
+bool ProjectFormat::writeFile(const QString &filename, const ProjectData &data, const ProgressCallback &progress,
+                              Encoding encoding)
+{
+    QSaveFile file(filename);
+    if (!file.open(QIODevice::WriteOnly)) return false;
+
+    if (!write(file, data, progress, encoding)) {
+        file.cancelWriting();
+        return false;
+    }
+
+    return file.commit();
+}
+
+bool ProjectFormat::writeCompressed(QIODevice &device, const ProjectData &data, const ProgressCallback &progress)
+{
+    const quint32 chunkCount = 2;
+    FileHeader header = makeHeader(data, COMPRESSED_VERSION, chunkCount);
+
+    // Packing takes longer than writing, so progress is reported per chunk
+    const QByteArray packed[chunkCount] = { packRecords(data.walls), packRecords(data.furniture) };
+    const quint32 types[chunkCount] = { CompressedWallChunk, CompressedFurnitureChunk };
+
+    ChunkEntry chunks[chunkCount];
+    quint64 offset = alignedOffset(header.tocOffset + chunkCount * sizeof(ChunkEntry));
+
+    for (quint32 i = 0; i < chunkCount; ++i) {
+        chunks[i] = ChunkEntry{ types[i], 1, offset, quint64(packed[i].size()) };
+        offset = alignedOffset(offset + packed[i].size());
+    }
+
+    const qint64 total = chunks[chunkCount - 1].offset + packed[chunkCount - 1].size();
+
+    toFileOrder(header);
+    if (device.write(reinterpret_cast<const char*>(&header), sizeof(header)) != qint64(sizeof(header))) return false;
+
+    for (ChunkEntry entry : chunks) {
+        toFileOrder(entry);
+        if (device.write(reinterpret_cast<const char*>(&entry), sizeof(entry)) != qint64(sizeof(entry))) return false;
+    }
+
+    const char padding[8] = {};
+    qint64 written = sizeof(FileHeader) + chunkCount * sizeof(ChunkEntry);
+
+    for (quint32 i = 0; i < chunkCount; ++i) {
+        if (device.write(padding, chunks[i].offset - written) < 0) return false;
+        if (device.write(packed[i]) != packed[i].size()) return false;
+
+        written = chunks[i].offset + packed[i].size();
+        if (progress) {
+            progress(written, total);
+        }
+    }
+
+    return true;
+}
+
+ProjectFormat::FileHeader ProjectFormat::makeHeader(const ProjectData &data, quint32 version, quint32 chunkCount)
+{
+    FileHeader header;
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = version;
+    header.headerSize = sizeof(FileHeader);
+    header.houseSize = data.houseSize;
+    header.canvasWidth = data.canvasSize.width();
+    header.canvasHeight = data.canvasSize.height();
+    header.chunkCount = chunkCount;
+    header.tocOffset = sizeof(FileHeader);
+
+    return header;
+}
+
+bool ProjectFormat::read(const char *data, qint64 size, ProjectData &result)
+{
+    FileHeader header;
+    if (!readHeader(data, size, header)) return false;
+
+    result = ProjectData();
+    result.houseSize = header.houseSize;
+    result.canvasSize = QSize(header.canvasWidth, header.canvasHeight);
+
+    for (quint32 i = 0; i < header.chunkCount; ++i) {
+        ChunkEntry entry = chunkAt(data, header, i);
+
+        switch (entry.type) {
+        case WallChunk:
+            if (!readRecords(data, size, entry, result.walls)) return false;
+            break;
+        case FurnitureChunk:
+            if (!readRecords(data, size, entry, result.furniture)) return false;
+            break;
+        case CompressedWallChunk:
+            if (!readCompressedRecords(data, size, entry, result.walls)) return false;
+            break;
+        case CompressedFurnitureChunk:
+            if (!readCompressedRecords(data, size, entry, result.furniture)) return false;
+            break;
+        default:
+            // Chunks from newer versions are skipped
+            break;
+        }
+    }
+
+    return true;
+}
+
+bool ProjectFormat::view(const char *data, qint64 size, ProjectView &result)
+{
+    FileHeader header;
+    if (!readHeader(data, size, header)) return false;
+
+    result = ProjectView();
+    result.houseSize = header.houseSize;
+    result.canvasSize = QSize(header.canvasWidth, header.canvasHeight);
+
+    for (quint32 i = 0; i < header.chunkCount; ++i) {
+        ChunkEntry entry = chunkAt(data, header, i);
+
+        switch (entry.type) {
+        case WallChunk:
+            if (!viewRecords(data, size, entry, result.walls, result.wallCount)) return false;
+            break;
+        case FurnitureChunk:
+            if (!viewRecords(data, size, entry, result.furniture, result.furnitureCount)) return false;
+            break;
+        case CompressedWallChunk:
+        case CompressedFurnitureChunk:
+            // Only read() unpacks these
+            return false;
+        default:
+            break;
+        }
+    }
+
+    return true;
+}
+
+bool ProjectFormat::readHeader(const char *data, qint64 size, FileHeader &header)
+{
+    if (size < qint64(sizeof(FileHeader)) || !isVersion2(data, size)) return false;
+
+    std::memcpy(&header, data, sizeof(header));
+    toFileOrder(header);
+
+    if (header.version != VERSION && header.version != COMPRESSED_VERSION) return false;
+    if (header.headerSize < sizeof(FileHeader)) return false;
+
+    return header.tocOffset <= quint64(size) &&
+           quint64(header.chunkCount) * sizeof(ChunkEntry) <= quint64(size) - header.tocOffset;
+}
+
+ProjectFormat::ChunkEntry ProjectFormat::chunkAt(const char *data, const FileHeader &header, quint32 index)
+{
+    ChunkEntry entry;
+    std::memcpy(&entry, data + header.tocOffset + index * sizeof(ChunkEntry), sizeof(entry));
+    toFileOrder(entry);
+
+    return entry;
+}
@@ -0,0 +1,131 @@
+#ifndef PROJECTFORMAT_H
+#define PROJECTFORMAT_H
+
+#include <QIODevice>
+#include <QSize>
+#include <QString>
+#include <QVector>
+#include <QtGlobal>
+
+#include <functional>
+
+
+// Version 2 project files: a fixed header, a table of contents and one array of
+// fixed-size records per chunk. Everything is little-endian and every chunk
+// starts at an 8 byte boundary, so on little-endian hosts the record arrays are
+// copied (or mapped) as they are.
+//
+//   FileHeader | ChunkEntry[chunkCount] | chunk data ...
+
+struct WallRecord {
+    qint32 x1;
+    qint32 y1;
+    qint32 x2;
+    qint32 y2;
+};
+
+struct FurnitureRecord {
+    double x;
+    double y;
+    double rotation;
+    quint32 type;
+    quint32 flags;
+
+    static const quint32 SELECTED = 0x1;
+};
+
+// Plain copy of everything a project file stores
+struct ProjectData {
+    qint32 houseSize = 0;
+    QSize canvasSize;
+    QVector<WallRecord> walls;
+    QVector<FurnitureRecord> furniture;
+};
+
+// The same, but pointing into a buffer owned by someone else (e.g. a mapped file)
+struct ProjectView {
+    qint32 houseSize = 0;
+    QSize canvasSize;
+    const WallRecord *walls = nullptr;
+    int wallCount = 0;
+    const FurnitureRecord *furniture = nullptr;
+    int furnitureCount = 0;
+
+    static ProjectView of(const ProjectData &data);
+};
+
+class ProjectFormat {
+public:
+    struct FileHeader {
+        char magic[8];
+        quint32 version;
+        quint32 headerSize;
+        qint32 houseSize;
+        qint32 canvasWidth;
+        qint32 canvasHeight;
+        quint32 chunkCount;
+        quint64 tocOffset;
+    };
+
+    struct ChunkEntry {
+        quint32 type;
+        quint32 recordSize;
+        quint64 offset;
+        quint64 count;
+    };
+
+    enum ChunkType : quint32 {
+        WallChunk = 0x4c4c4157,                 // "WALL"
+        FurnitureChunk = 0x4e525546,            // "FURN"
+        CompressedWallChunk = 0x5a4c4157,       // "WALZ"
+        CompressedFurnitureChunk = 0x5a525546   // "FURZ"
+    };
+
+    // Compressed chunks hold the records column by column, each value as the
+    // zigzag varint of its difference to the previous one, deflated with
+    // qCompress(). Furniture positions and rotations are rounded to 1/256
+    // first. Their entries count bytes (recordSize 1), the record count is
+    // inside the chunk.
+    enum class Encoding {
+        Plain,
+        Compressed
+    };
+
+    static const quint32 VERSION = 2;
+
+    // Files with compressed chunks, so readers that would skip those chunks
+    // refuse the file instead of loading an empty plan
+    static const quint32 COMPRESSED_VERSION = 3;
+
+    // Whether the bytes start with a version 2 header
+    static bool isVersion2(const char *data, qint64 size);
+
+    // Called with the bytes written so far and the final size
+    typedef std::function<void(qint64, qint64)> ProgressCallback;
+
+    static bool write(QIODevice &device, const ProjectData &data,
+                      const ProgressCallback &progress = ProgressCallback(),
+                      Encoding encoding = Encoding::Plain);
+    // Writes through QSaveFile, so the target is only replaced by a complete file
+    static bool writeFile(const QString &filename, const ProjectData &data,
+                          const ProgressCallback &progress = ProgressCallback(),
+                          Encoding encoding = Encoding::Plain);
+
+    static bool read(const char *data, qint64 size, ProjectData &result);
+
+    // Zero-copy variant of read(). Fails when the records cannot be used in
+    // place (big-endian host, different record size, misaligned buffer or
+    // compressed chunks), in which case read() still works.
+    static bool view(const char *data, qint64 size, ProjectView &result);
+
+private:
+    static const char MAGIC[8];
+
+    static FileHeader makeHeader(const ProjectData &data, quint32 version, quint32 chunkCount);
+    static bool writeCompressed(QIODevice &device, const ProjectData &data, const ProgressCallback &progress);
+
+    static bool readHeader(const char *data, qint64 size, FileHeader &header);
+    static ChunkEntry chunkAt(const char *data, const FileHeader &header, quint32 index);
+};
+
+#endif // PROJECTFORMAT_H
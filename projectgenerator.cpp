@@ -0,0 +1,127 @@
+#include "projectgenerator.h"
+
+#include <QRandomGenerator>
+#include <QVector>
+
+#include <algorithm>
+
+
+ProjectGenerator::Result ProjectGenerator::generate(Project &project, const Parameters &parameters)
+{
+    QRandomGenerator random(parameters.seed);
+    Result result;
+
+    project.newProject(parameters.canvasSize);
+    QSize canvas = project.getCanvasSize();
+
+    // Smallest k x k room grid whose 2k(k + 1) edges cover the wall count
+    int wallCount = qMax(0, parameters.wallCount);
+    int gridSize = 1;
+    while (2 * gridSize * (gridSize + 1) < wallCount) {
+        ++gridSize;
+    }
+
+    qreal roomWidth = qreal(canvas.width()) / gridSize;
+    qreal roomHeight = qreal(canvas.height()) / gridSize;
+
+    auto gridPoint = [&](int column, int row) {
+        return QPoint(qRound(column * roomWidth), qRound(row * roomHeight));
+    };
+
+    // Row by row, so a partial grid still closes the rooms at the top first.
+    // Nobody draws the generated project, so its dirty region is dropped as
+    // it goes instead of growing with every wall and item.
+    for (int row = 0; row <= gridSize && result.walls < wallCount; ++row) {
+        for (int column = 0; column < gridSize && result.walls < wallCount; ++column) {
+            project.addWall(Wall(gridPoint(column, row), gridPoint(column + 1, row)));
+            project.takeDirtyRegion();
+            ++result.walls;
+        }
+
+        for (int column = 0; row < gridSize && column <= gridSize && result.walls < wallCount; ++column) {
+            project.addWall(Wall(gridPoint(column, row), gridPoint(column, row + 1)));
+            project.takeDirtyRegion();
+            ++result.walls;
+        }
+    }
+
+    // Furnished rooms are picked at random
+    QVector<int> rooms;
+    for (int i = 0; i < gridSize * gridSize; ++i) {
+        rooms.append(i);
+    }
+
+    for (int i = rooms.size() - 1; i > 0; --i) {
+        std::swap(rooms[i], rooms[int(random.bounded(i + 1))]);
+    }
+
+    int furnishedRooms = qBound(1, qRound(parameters.density * rooms.size()), rooms.size());
+
+    const FurnitureType types[] = { FurnitureType::Sofa, FurnitureType::Chair, FurnitureType::Table };
+    const qreal weights[] = { qMax<qreal>(0, parameters.sofaWeight), qMax<qreal>(0, parameters.chairWeight),
+                              qMax<qreal>(0, parameters.tableWeight) };
+    qreal totalWeight = weights[0] + weights[1] + weights[2];
+
+    // Keeps rotated items of any type clear of the room's walls
+    const qreal WALL_MARGIN = 35;
+
+    for (int i = 0; i < parameters.furnitureCount; ++i) {
+        FurnitureType type = FurnitureType::Chair;
+        if (totalWeight > 0) {
+            qreal pick = random.generateDouble() * totalWeight;
+            int index = 0;
+            while (index < 2 && pick >= weights[index]) {
+                pick -= weights[index];
+                ++index;
+            }
+
+            type = types[index];
+        }
+
+        qreal rotation = 0;
+        switch (parameters.rotation) {
+        case Rotation::None:
+            break;
+        case Rotation::RightAngles:
+            rotation = 90 * random.bounded(4);
+            break;
+        case Rotation::Octants:
+            rotation = 45 * random.bounded(8);
+            break;
+        case Rotation::Uniform:
+            rotation = random.generateDouble() * 360;
+            break;
+        }
+
+        Furniture *item = Project::createFurniture(type, QPointF());
+        item->setRotation(rotation);
+
+        bool placed = false;
+        int attempts = qMax(1, parameters.placementAttempts);
+
+        for (int attempt = 0; attempt < attempts && !placed; ++attempt) {
+            int room = rooms[int(random.bounded(furnishedRooms))];
+            QRectF area(gridPoint(room % gridSize, room / gridSize), gridPoint(room % gridSize + 1, room / gridSize + 1));
+            area.adjust(WALL_MARGIN, WALL_MARGIN, -WALL_MARGIN, -WALL_MARGIN);
+
+            QPointF position = area.center();
+            if (area.isValid()) {
+                position = QPointF(area.left() + random.generateDouble() * area.width(),
+                                   area.top() + random.generateDouble() * area.height());
+            }
+
+            item->setPosition(position);
+            placed = project.findCollisions({ item }).isEmpty();
+        }
+
+        if (!placed) {
+            ++result.overlapping;
+        }
+
+        project.addFurniture(item);
+        project.takeDirtyRegion();
+        ++result.furniture;
+    }
+
+    return result;
+}
@@ -0,0 +1,51 @@
+#ifndef PROJECTGENERATOR_H
+#define PROJECTGENERATOR_H
+
+#include "project.h"
+#include <QSize>
+
+
+// Builds synthetic projects for scale and stress tests. Walls form a grid of
+// rooms over the canvas, furniture is scattered inside the rooms. The same
+// parameters and seed always give the same project.
+class ProjectGenerator {
+public:
+    enum class Rotation {
+        None,
+        RightAngles,
+        Octants,
+        Uniform
+    };
+
+    struct Parameters {
+        QSize canvasSize = QSize(10000, 10000);
+        int wallCount = 400;
+        int furnitureCount = 5000;
+
+        // Relative share of each furniture type
+        qreal sofaWeight = 1;
+        qreal chairWeight = 4;
+        qreal tableWeight = 1;
+
+        // Share of the rooms that get furniture, the rest stay empty
+        qreal density = 1;
+
+        Rotation rotation = Rotation::RightAngles;
+
+        // Free spots tried per item before it is placed overlapping anyway
+        int placementAttempts = 20;
+
+        quint32 seed = 1;
+    };
+
+    struct Result {
+        int walls = 0;
+        int furniture = 0;
+        int overlapping = 0;
+    };
+
+    // Replaces the contents of the project
+    static Result generate(Project &project, const Parameters &parameters);
+};
+
+#endif // PROJECTGENERATOR_H
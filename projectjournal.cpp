@@ -0,0 +1,312 @@
+#include "projectjournal.h"
+#include "project.h"
+
+#include <QDir>
+#include <QSaveFile>
+
+#include <cstring>
+
+
+static_assert(sizeof(JournalRecord) == 64, "journal records are read back by size");
+
+const char ProjectJournal::MAGIC[8] = { 'H', 'L', 'D', 'J', 'R', 'N', 'L', '1' };
+
+ProjectJournal::ProjectJournal(QObject *parent)
+    : QObject(parent), m_active(false), m_commandDepth(0), m_sequence(0),
+    m_recordsSinceSnapshot(0), m_hasRecovery(false), m_worker(new QObject)
+{
+    m_worker->moveToThread(&m_thread);
+
+    m_flushTimer.setSingleShot(true);
+    m_flushTimer.setInterval(FLUSH_INTERVAL);
+    connect(&m_flushTimer, &QTimer::timeout, this, &ProjectJournal::flush);
+}
+
+ProjectJournal::~ProjectJournal()
+{
+    if (m_thread.isRunning()) {
+        flush();
+
+        // Queued behind every pending write
+        QMetaObject::invokeMethod(m_worker, [this]() {
+            m_logFile.reset();
+            m_thread.quit();
+        }, Qt::QueuedConnection);
+
+        m_thread.wait();
+    }
+
+    delete m_worker;
+}
+
+bool ProjectJournal::open(const QString &directory)
+{
+    if (isOpen()) return true;
+    if (!QDir().mkpath(directory)) return false;
+
+    // Locks left by a crashed instance are detected as stale and taken over
+    std::unique_ptr<QLockFile> lock(new QLockFile(directory + "/journal.lock"));
+    if (!lock->tryLock(0)) return false;
+
+    m_lock = std::move(lock);
+    m_directory = directory;
+
+    readPrevious();
+    m_thread.start();
+
+    return true;
+}
+
+bool ProjectJournal::isOpen() const
+{
+    return m_lock != nullptr;
+}
+
+bool ProjectJournal::hasRecoverableChanges() const
+{
+    return m_hasRecovery;
+}
+
+bool ProjectJournal::recover(Project &project)
+{
+    if (!m_hasRecovery) return false;
+
+    project.setData(m_recoveredSnapshot);
+
+    for (const JournalRecord &record : m_recoveredRecords) {
+        // Nothing after a record that does not fit can be trusted
+        if (!apply(project, record)) break;
+    }
+
+    m_hasRecovery = false;
+    m_recoveredSnapshot = ProjectData();
+    m_recoveredRecords.clear();
+
+    return true;
+}
+
+void ProjectJournal::reset(const ProjectData &snapshot, bool saved)
+{
+    if (!isOpen()) return;
+
+    // Buffered records are part of the snapshot already
+    m_active = true;
+    m_buffer.clear();
+    m_flushTimer.stop();
+    m_recordsSinceSnapshot = 0;
+
+    m_hasRecovery = false;
+    m_recoveredSnapshot = ProjectData();
+    m_recoveredRecords.clear();
+
+    SnapshotHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, MAGIC, sizeof(header.magic));
+    header.sequence = m_sequence;
+    header.saved = saved ? 1 : 0;
+
+    QString snapshotFile = snapshotPath();
+    QString logFile = logPath();
+
+    QMetaObject::invokeMethod(m_worker, [this, header, snapshot, snapshotFile, logFile]() {
+        m_logFile.reset();
+
+        QSaveFile file(snapshotFile);
+        if (!file.open(QIODevice::WriteOnly)) return;
+
+        if (file.write(reinterpret_cast<const char*>(&header), sizeof(header)) != qint64(sizeof(header))
+            || !ProjectFormat::write(file, snapshot)) {
+            file.cancelWriting();
+            return;
+        }
+
+        if (!file.commit()) return;
+
+        // Records older than the snapshot are skipped on recovery, so a crash
+        // before the truncation does no harm
+        m_logFile.reset(new QFile(logFile));
+        if (!m_logFile->open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            m_logFile.reset();
+        }
+    }, Qt::QueuedConnection);
+}
+
+void ProjectJournal::discard()
+{
+    if (!isOpen()) return;
+
+    m_active = false;
+    m_buffer.clear();
+    m_flushTimer.stop();
+
+    QString snapshotFile = snapshotPath();
+    QString logFile = logPath();
+
+    QMetaObject::invokeMethod(m_worker, [this, snapshotFile, logFile]() {
+        m_logFile.reset();
+        QFile::remove(snapshotFile);
+        QFile::remove(logFile);
+    }, Qt::QueuedConnection);
+}
+
+void ProjectJournal::beginCommand()
+{
+    ++m_commandDepth;
+}
+
+void ProjectJournal::endCommand()
+{
+    --m_commandDepth;
+
+    if (m_commandDepth == 0 && m_active && m_recordsSinceSnapshot >= COMPACT_THRESHOLD) {
+        emit compactionNeeded();
+    }
+}
+
+bool ProjectJournal::isRecording() const
+{
+    return m_active && m_commandDepth > 0;
+}
+
+void ProjectJournal::record(JournalRecord record)
+{
+    if (!isRecording()) return;
+
+    record.sequence = ++m_sequence;
+    m_buffer.append(reinterpret_cast<const char*>(&record), sizeof(record));
+    ++m_recordsSinceSnapshot;
+
+    if (m_buffer.size() >= FLUSH_SIZE) {
+        flush();
+    }
+    else if (!m_flushTimer.isActive()) {
+        m_flushTimer.start();
+    }
+}
+
+bool ProjectJournal::apply(Project &project, const JournalRecord &record)
+{
+    int furnitureCount = project.furnitureCount();
+    int wallCount = project.walls().size();
+
+    switch (record.operation) {
+    case JournalRecord::InsertFurniture: {
+        if (record.index < 0 || record.index > furnitureCount) return false;
+
+        Furniture *item = Project::createFurniture(static_cast<FurnitureType>(record.furnitureType),
+                                                   QPointF(record.x, record.y));
+        if (!item) return false;
+
+        item->setRotation(record.rotation);
+        project.insertFurniture(record.index, item);
+        return true;
+    }
+    case JournalRecord::RemoveFurniture: {
+        if (record.index < 0 || record.index >= furnitureCount) return false;
+
+        Furniture *item = project.takeFurnitureAt(record.index);
+        project.releaseFurniture(item);
+        delete item;
+        return true;
+    }
+    case JournalRecord::MoveFurniture:
+        if (record.index < 0 || record.index >= furnitureCount) return false;
+
+        project.setFurniturePosition(project.furnitureAt(record.index), QPointF(record.x, record.y));
+        return true;
+    case JournalRecord::RotateFurniture:
+        if (record.index < 0 || record.index >= furnitureCount) return false;
+
+        project.setFurnitureRotation(project.furnitureAt(record.index), record.rotation);
+        return true;
+    case JournalRecord::InsertWall:
+        if (record.index < 0 || record.index > wallCount) return false;
+
+        project.insertWall(record.index, Wall(QPoint(record.wall[0], record.wall[1]),
+                                              QPoint(record.wall[2], record.wall[3])));
+        return true;
+    case JournalRecord::RemoveWall:
+        if (record.index < 0 || record.index >= wallCount) return false;
+
+        project.removeWallAt(record.index);
+        return true;
+    }
+
+    return false;
+}
+
+QString ProjectJournal::snapshotPath() const
+{
+    return m_directory + "/journal.snapshot";
+}
+
+QString ProjectJournal::logPath() const
+{
+    return m_directory + "/journal.log";
+}
+
+void ProjectJournal::readPrevious()
+{
+    QFile snapshotFile(snapshotPath());
+    if (!snapshotFile.open(QIODevice::ReadOnly)) return;
+
+    QByteArray bytes = snapshotFile.readAll();
+    if (bytes.size() < int(sizeof(SnapshotHeader))) return;
+
+    SnapshotHeader header;
+    std::memcpy(&header, bytes.constData(), sizeof(header));
+    if (std::memcmp(header.magic, MAGIC, sizeof(header.magic)) != 0) return;
+
+    ProjectData snapshot;
+    if (!ProjectFormat::read(bytes.constData() + sizeof(header), bytes.size() - sizeof(header), snapshot)) return;
+
+    // Continue the numbering, so records left in an old log never look newer
+    // than the next snapshot
+    m_sequence = header.sequence;
+
+    QVector<JournalRecord> records;
+    QFile logFile(logPath());
+    if (logFile.open(QIODevice::ReadOnly)) {
+        QByteArray log = logFile.readAll();
+
+        // A record torn by the crash is dropped with the size division
+        int count = log.size() / int(sizeof(JournalRecord));
+        bool contiguous = true;
+        for (int i = 0; i < count; ++i) {
+            JournalRecord record;
+            std::memcpy(&record, log.constData() + i * sizeof(JournalRecord), sizeof(record));
+
+            m_sequence = qMax(m_sequence, record.sequence);
+            if (!contiguous || record.sequence <= header.sequence) continue;
+
+            // Stop at the first gap, later records depend on the missing ones
+            quint64 expected = records.isEmpty() ? header.sequence + 1 : records.last().sequence + 1;
+            if (record.sequence != expected) {
+                contiguous = false;
+                continue;
+            }
+
+            records.append(record);
+        }
+    }
+
+    m_recoveredSnapshot = snapshot;
+    m_recoveredRecords = records;
+    m_hasRecovery = !header.saved || !records.isEmpty();
+}
+
+void ProjectJournal::flush()
+{
+    m_flushTimer.stop();
+    if (m_buffer.isEmpty()) return;
+
+    QByteArray bytes = m_buffer;
+    m_buffer.clear();
+
+    QMetaObject::invokeMethod(m_worker, [this, bytes]() {
+        if (!m_logFile) return;
+
+        m_logFile->write(bytes);
+        m_logFile->flush();
+    }, Qt::QueuedConnection);
+}
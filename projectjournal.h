@@ -0,0 +1,121 @@
+#ifndef PROJECTJOURNAL_H
+#define PROJECTJOURNAL_H
+
+#include "projectformat.h"
+#include <QByteArray>
+#include <QFile>
+#include <QLockFile>
+#include <QObject>
+#include <QString>
+#include <QThread>
+#include <QTimer>
+#include <QVector>
+
+#include <memory>
+
+class Project;
+
+
+// One model change made by a command. Furniture and walls are referred to by
+// their position in the project lists, which replay reproduces exactly.
+struct JournalRecord {
+    enum Operation : quint32 {
+        InsertFurniture = 1,
+        RemoveFurniture,
+        MoveFurniture,
+        RotateFurniture,
+        InsertWall,
+        RemoveWall
+    };
+
+    quint64 sequence;
+    quint32 operation;
+    qint32 index;
+    quint32 furnitureType;
+    qint32 wall[4];
+    double x;
+    double y;
+    double rotation;
+};
+
+// Crash recovery for unsaved work. Every change a command makes is appended
+// to a log as a small record, written on a worker thread. Now and then the log
+// is compacted: the whole project is written as a snapshot and the log starts
+// over. After a crash, the snapshot plus the newer log records give back the
+// last state. Both files are local and use the host byte order.
+class ProjectJournal : public QObject {
+    Q_OBJECT
+
+public:
+    explicit ProjectJournal(QObject *parent = nullptr);
+    ~ProjectJournal();
+
+    // Fails when another instance already uses the directory
+    bool open(const QString &directory);
+    bool isOpen() const;
+
+    // What the previous session left behind, read by open()
+    bool hasRecoverableChanges() const;
+    bool recover(Project &project);
+
+    // Starts over from the given state. Nothing is offered for recovery
+    // later if the state is saved and no changes follow.
+    void reset(const ProjectData &snapshot, bool saved);
+
+    // Clean shutdown, nothing to recover
+    void discard();
+
+    // CommandManager brackets every execute, undo and redo with these
+    void beginCommand();
+    void endCommand();
+    bool isRecording() const;
+
+    void record(JournalRecord record);
+
+    // Replays one record, false if it does not fit the project
+    static bool apply(Project &project, const JournalRecord &record);
+
+signals:
+    // Enough records since the last snapshot, time to call reset() again
+    void compactionNeeded();
+
+private:
+    struct SnapshotHeader {
+        char magic[8];
+        quint64 sequence;
+        quint32 saved;
+        quint32 reserved;
+    };
+
+    QString m_directory;
+    std::unique_ptr<QLockFile> m_lock;
+
+    bool m_active;
+    int m_commandDepth;
+    quint64 m_sequence;
+    int m_recordsSinceSnapshot;
+    QByteArray m_buffer;
+    QTimer m_flushTimer;
+
+    bool m_hasRecovery;
+    ProjectData m_recoveredSnapshot;
+    QVector<JournalRecord> m_recoveredRecords;
+
+    // The log file lives on the worker thread
+    QThread m_thread;
+    QObject *m_worker;
+    std::unique_ptr<QFile> m_logFile;
+
+    QString snapshotPath() const;
+    QString logPath() const;
+
+    void readPrevious();
+    void flush();
+
+    static const char MAGIC[8];
+    static const int FLUSH_INTERVAL = 1000;
+    static const int FLUSH_SIZE = 64 * 1024;
+    static const int COMPACT_THRESHOLD = 20000;
+};
+
+#endif // PROJECTJOURNAL_H
@@ -0,0 +1,220 @@
+#include "projectloader.h"
+#include "project.h"
+
+#include <QElapsedTimer>
+#include <QFile>
+
+#include <algorithm>
+
+
+ProjectLoader::ProjectLoader(QObject *parent)
+    : QObject(parent), m_worker(nullptr), m_startedSent(false), m_totalRecords(0),
+    m_deliveredRecords(0), m_headerRead(false), m_houseSize(0), m_headerRecords(0),
+    m_cancelled(false), m_success(false)
+{
+    m_drainTimer.setInterval(DRAIN_INTERVAL);
+    connect(&m_drainTimer, &QTimer::timeout, this, &ProjectLoader::drain);
+}
+
+ProjectLoader::~ProjectLoader()
+{
+    if (!m_worker) return;
+
+    // Stopped without finished(), the receivers may already be gone
+    {
+        QMutexLocker locker(&m_mutex);
+        m_cancelled = true;
+        m_spaceAvailable.wakeAll();
+    }
+
+    m_worker->wait();
+    delete m_worker;
+}
+
+bool ProjectLoader::isLoading() const
+{
+    return m_worker != nullptr;
+}
+
+void ProjectLoader::load(const QString &filename)
+{
+    cancel();
+
+    m_filename = filename;
+    m_startedSent = false;
+    m_totalRecords = 0;
+    m_deliveredRecords = 0;
+
+    m_headerRead = false;
+    m_headerRecords = 0;
+    m_cancelled = false;
+    m_success = false;
+
+    emit progressChanged(0);
+
+    m_worker = QThread::create([this, filename]() {
+        read(filename);
+    });
+
+    m_worker->start();
+    m_drainTimer.start();
+}
+
+void ProjectLoader::cancel()
+{
+    if (!m_worker) return;
+
+    {
+        QMutexLocker locker(&m_mutex);
+        m_cancelled = true;
+        m_batches.clear();
+        m_spaceAvailable.wakeAll();
+    }
+
+    m_worker->wait();
+    finish();
+}
+
+void ProjectLoader::drain()
+{
+    if (!m_worker) return;
+
+    QElapsedTimer elapsed;
+    elapsed.start();
+
+    do {
+        QMutexLocker locker(&m_mutex);
+
+        if (!m_startedSent) {
+            if (!m_headerRead) break;
+
+            int houseSize = m_houseSize;
+            QSize canvasSize = m_canvasSize;
+            m_totalRecords = m_headerRecords;
+            m_startedSent = true;
+            locker.unlock();
+
+            emit started(houseSize, canvasSize);
+            continue;
+        }
+
+        if (m_batches.isEmpty()) break;
+
+        ProjectData batch = m_batches.dequeue();
+        m_spaceAvailable.wakeOne();
+        locker.unlock();
+
+        m_deliveredRecords += batch.walls.size() + batch.furniture.size();
+
+        emit batchLoaded(ProjectView::of(batch));
+        emit progressChanged(m_totalRecords > 0 ? int(m_deliveredRecords * 100 / m_totalRecords) : 100);
+    } while (m_worker && elapsed.elapsed() < DRAIN_BUDGET);
+
+    if (!m_worker || !m_worker->isFinished()) return;
+
+    QMutexLocker locker(&m_mutex);
+    if (m_batches.isEmpty() && (m_startedSent || !m_headerRead)) {
+        locker.unlock();
+        finish();
+    }
+}
+
+void ProjectLoader::finish()
+{
+    m_drainTimer.stop();
+
+    delete m_worker;
+    m_worker = nullptr;
+
+    Status status = Status::Failed;
+    if (m_cancelled) {
+        status = Status::Cancelled;
+    }
+    else if (m_success && m_startedSent) {
+        status = Status::Loaded;
+    }
+
+    m_batches.clear();
+
+    emit progressChanged(100);
+    emit finished(m_filename, status);
+}
+
+void ProjectLoader::read(const QString &filename)
+{
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly)) return;
+
+    // Owns the records when they cannot be used from the mapped file
+    ProjectData data;
+    ProjectView view;
+
+    QByteArray head = file.peek(sizeof(ProjectFormat::FileHeader));
+    if (ProjectFormat::isVersion2(head.constData(), head.size())) {
+        uchar *mapped = file.map(0, file.size());
+
+        if (!mapped || !ProjectFormat::view(reinterpret_cast<const char*>(mapped), file.size(), view)) {
+            QByteArray bytes = file.readAll();
+            if (!ProjectFormat::read(bytes.constData(), bytes.size(), data)) return;
+
+            view = ProjectView::of(data);
+        }
+    }
+    else {
+        // Version 1 has no record layout to stream from
+        Project project;
+        if (!project.load(filename)) return;
+
+        data = project.data();
+        view = ProjectView::of(data);
+    }
+
+    // The mapping stays valid until the file is closed
+    bool success = stream(view);
+
+    QMutexLocker locker(&m_mutex);
+    m_success = success;
+}
+
+bool ProjectLoader::stream(const ProjectView &view)
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_houseSize = view.houseSize;
+        m_canvasSize = view.canvasSize;
+        m_headerRecords = qint64(view.wallCount) + view.furnitureCount;
+        m_headerRead = true;
+    }
+
+    for (int start = 0; start < view.wallCount; start += BATCH_SIZE) {
+        ProjectData batch;
+        batch.walls.resize(qMin(BATCH_SIZE, view.wallCount - start));
+        std::copy(view.walls + start, view.walls + start + batch.walls.size(), batch.walls.begin());
+
+        if (!push(batch)) return false;
+    }
+
+    for (int start = 0; start < view.furnitureCount; start += BATCH_SIZE) {
+        ProjectData batch;
+        batch.furniture.resize(qMin(BATCH_SIZE, view.furnitureCount - start));
+        std::copy(view.furniture + start, view.furniture + start + batch.furniture.size(), batch.furniture.begin());
+
+        if (!push(batch)) return false;
+    }
+
+    return true;
+}
+
+bool ProjectLoader::push(const ProjectData &batch)
+{
+    QMutexLocker locker(&m_mutex);
+
+    while (!m_cancelled && m_batches.size() >= MAX_QUEUED) {
+        m_spaceAvailable.wait(&m_mutex);
+    }
+
+    if (m_cancelled) return false;
+
+    m_batches.enqueue(batch);
+    return true;
+}
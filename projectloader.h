@@ -0,0 +1,82 @@
+#ifndef PROJECTLOADER_H
+#define PROJECTLOADER_H
+
+#include "projectformat.h"
+#include <QMutex>
+#include <QObject>
+#include <QQueue>
+#include <QString>
+#include <QThread>
+#include <QTimer>
+#include <QWaitCondition>
+
+
+// Reads a project on a worker thread and hands the records to the GUI thread
+// in batches, so the canvas fills up while the file is still being read. The
+// batches wait in a small bounded queue that a timer drains a few milliseconds
+// at a time, which keeps painting and input going. Version 2 files are
+// streamed from the mapped file; version 1 files are parsed as a whole first.
+class ProjectLoader : public QObject {
+    Q_OBJECT
+
+public:
+    enum class Status {
+        Loaded,
+        Failed,
+        Cancelled
+    };
+
+    explicit ProjectLoader(QObject *parent = nullptr);
+    ~ProjectLoader();
+
+    bool isLoading() const;
+
+    // Cancels a load that is still running
+    void load(const QString &filename);
+
+    // finished() is still emitted, with Status::Cancelled
+    void cancel();
+
+signals:
+    // Batches carry only records; the house and canvas size come with started()
+    void started(int houseSize, const QSize &canvasSize);
+    void batchLoaded(const ProjectView &batch);
+    void progressChanged(int percent);
+    void finished(const QString &filename, ProjectLoader::Status status);
+
+private slots:
+    void drain();
+
+private:
+    QThread *m_worker;
+    QString m_filename;
+    QTimer m_drainTimer;
+    bool m_startedSent;
+    qint64 m_totalRecords;
+    qint64 m_deliveredRecords;
+
+    // Shared with the worker
+    QMutex m_mutex;
+    QWaitCondition m_spaceAvailable;
+    QQueue<ProjectData> m_batches;
+    bool m_headerRead;
+    int m_houseSize;
+    QSize m_canvasSize;
+    qint64 m_headerRecords;
+    bool m_cancelled;
+    bool m_success;
+
+    // Worker side
+    void read(const QString &filename);
+    bool stream(const ProjectView &view);
+    bool push(const ProjectData &batch);
+
+    void finish();
+
+    static const int BATCH_SIZE = 8192;
+    static const int MAX_QUEUED = 8;
+    static const int DRAIN_INTERVAL = 10;
+    static const int DRAIN_BUDGET = 8;
+};
+
+#endif // PROJECTLOADER_H
@@ -0,0 +1,78 @@
+#include "projectsaver.h"
+
+
+ProjectSaver::ProjectSaver(QObject *parent)
+    : QObject(parent), m_worker(nullptr), m_success(false), m_hasPending(false),
+    m_pendingEncoding(ProjectFormat::Encoding::Plain) {}
+
+ProjectSaver::~ProjectSaver()
+{
+    waitForFinished();
+}
+
+bool ProjectSaver::isSaving() const
+{
+    return m_worker != nullptr;
+}
+
+void ProjectSaver::save(const QString &filename, const ProjectData &snapshot, ProjectFormat::Encoding encoding)
+{
+    if (m_worker) {
+        m_hasPending = true;
+        m_pendingFilename = filename;
+        m_pendingSnapshot = snapshot;
+        m_pendingEncoding = encoding;
+        return;
+    }
+
+    start(filename, snapshot, encoding);
+}
+
+void ProjectSaver::waitForFinished()
+{
+    while (m_worker) {
+        m_worker->wait();
+        workerFinished();
+    }
+}
+
+void ProjectSaver::workerFinished()
+{
+    // Reached once per worker, either from its signal or from waitForFinished()
+    if (!m_worker || !m_worker->isFinished()) return;
+
+    delete m_worker;
+    m_worker = nullptr;
+
+    emit progressChanged(100);
+    emit finished(m_filename, m_success);
+
+    if (m_hasPending) {
+        m_hasPending = false;
+        start(m_pendingFilename, m_pendingSnapshot, m_pendingEncoding);
+        m_pendingSnapshot = ProjectData();
+    }
+}
+
+void ProjectSaver::start(const QString &filename, const ProjectData &snapshot, ProjectFormat::Encoding encoding)
+{
+    m_filename = filename;
+    m_success = false;
+
+    emit progressChanged(0);
+
+    m_worker = QThread::create([this, filename, snapshot, encoding]() {
+        int lastPercent = 0;
+
+        m_success = ProjectFormat::writeFile(filename, snapshot, [this, &lastPercent](qint64 written, qint64 total) {
+            int percent = total > 0 ? int(written * 100 / total) : 100;
+            if (percent != lastPercent) {
+                lastPercent = percent;
+                emit progressChanged(percent);
+            }
+        }, encoding);
+    });
+
+    connect(m_worker, &QThread::finished, this, &ProjectSaver::workerFinished, Qt::QueuedConnection);
+    m_worker->start();
+}
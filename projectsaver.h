@@ -0,0 +1,50 @@
+#ifndef PROJECTSAVER_H
+#define PROJECTSAVER_H
+
+#include "projectformat.h"
+#include <QObject>
+#include <QString>
+#include <QThread>
+
+
+// Writes project snapshots on a worker thread. The snapshot is a plain copy of
+// the records (see Project::data()), so the model can keep changing meanwhile.
+// Files are written through QSaveFile and only replace the target once they
+// are complete. A save requested while another one runs is queued; only the
+// latest queued one is kept.
+class ProjectSaver : public QObject {
+    Q_OBJECT
+
+public:
+    explicit ProjectSaver(QObject *parent = nullptr);
+    ~ProjectSaver();
+
+    bool isSaving() const;
+
+    void save(const QString &filename, const ProjectData &snapshot,
+              ProjectFormat::Encoding encoding = ProjectFormat::Encoding::Plain);
+
+    // Blocks until the running and queued saves are done
+    void waitForFinished();
+
+signals:
+    void progressChanged(int percent);
+    void finished(const QString &filename, bool success);
+
+private slots:
+    void workerFinished();
+
+private:
+    QThread *m_worker;
+    QString m_filename;
+    bool m_success;
+
+    bool m_hasPending;
+    QString m_pendingFilename;
+    ProjectData m_pendingSnapshot;
+    ProjectFormat::Encoding m_pendingEncoding;
+
+    void start(const QString &filename, const ProjectData &snapshot, ProjectFormat::Encoding encoding);
+};
+
+#endif // PROJECTSAVER_H
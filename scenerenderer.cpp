@@ -0,0 +1,187 @@
+#include "scenerenderer.h"
+
+#include <QtMath>
+
+
+QTransform SceneRenderer::View::transform() const
+{
+    QTransform transform;
+    transform.scale(zoom, zoom);
+    transform.translate(-origin.x(), -origin.y());
+
+    return transform;
+}
+
+QPointF SceneRenderer::View::mapToWorld(const QPointF &devicePos) const
+{
+    return devicePos / zoom + origin;
+}
+
+QRectF SceneRenderer::View::mapToWorld(const QRect &deviceRect) const
+{
+    return QRectF(mapToWorld(QPointF(deviceRect.topLeft())), QSizeF(deviceRect.size()) / zoom);
+}
+
+SceneRenderer::SceneRenderer() : m_antialiasing(true) {}
+
+bool SceneRenderer::antialiasing() const
+{
+    return m_antialiasing;
+}
+
+void SceneRenderer::setAntialiasing(bool enabled)
+{
+    m_antialiasing = enabled;
+    m_sprites.setAntialiasing(enabled);
+}
+
+void SceneRenderer::clearSprites()
+{
+    m_sprites.clear();
+}
+
+void SceneRenderer::beginWorld(QPainter &painter, const View &view) const
+{
+    painter.setRenderHint(QPainter::Antialiasing, m_antialiasing);
+    painter.setTransform(view.transform());
+}
+
+void SceneRenderer::paintGrid(QPainter &painter, const Project &project, const View &view, const QRect &rect) const
+{
+    painter.save();
+    painter.fillRect(rect, QColor(240, 240, 240));
+    beginWorld(painter, view);
+
+    QRectF canvasRect(QPointF(0, 0), QSizeF(project.getCanvasSize()));
+    QRectF visible = view.mapToWorld(rect) & canvasRect;
+    painter.fillRect(visible, Qt::white);
+
+    // Coarser when zoomed out so lines stay a few pixels apart
+    QPen gridPen(QColor(230, 230, 230), 1, Qt::SolidLine);
+    gridPen.setCosmetic(true);
+    painter.setPen(gridPen);
+
+    int gridSize = 10;
+    while (gridSize * view.zoom < 5) {
+        gridSize *= 2;
+    }
+
+    for (qreal x = qFloor(visible.left() / gridSize) * gridSize; x < visible.right(); x += gridSize) {
+        painter.drawLine(QLineF(x, visible.top(), x, visible.bottom()));
+    }
+    for (qreal y = qFloor(visible.top() / gridSize) * gridSize; y < visible.bottom(); y += gridSize) {
+        painter.drawLine(QLineF(visible.left(), y, visible.right(), y));
+    }
+
+    painter.restore();
+}
+
+void SceneRenderer::paintWalls(QPainter &painter, const Project &project, const View &view, const QRect &rect) const
+{
+    painter.save();
+    beginWorld(painter, view);
+
+    painter.setPen(QPen(Qt::black, 5, Qt::SolidLine, Qt::RoundCap));
+    QRectF area = view.mapToWorld(rect).adjusted(-PAINT_MARGIN, -PAINT_MARGIN, PAINT_MARGIN, PAINT_MARGIN);
+    for (int i : project.wallsIn(area)) {
+        project.walls()[i].draw(painter);
+    }
+
+    painter.restore();
+}
+
+void SceneRenderer::paintFurniture(QPainter &painter, const Project &project, const View &view, const QRect &rect)
+{
+    painter.save();
+    beginWorld(painter, view);
+
+    QRectF area = view.mapToWorld(rect).adjusted(-PAINT_MARGIN, -PAINT_MARGIN, PAINT_MARGIN, PAINT_MARGIN);
+    // Straight from the store's columns, rows loaded from a file have no objects yet
+    const FurnitureStore &store = project.furnitureStore();
+    for (int row : project.furnitureRowsIn(area)) {
+        if (!store.isSelected(row)) {
+            m_sprites.draw(painter, store.types()[row], store.positions()[row], store.rotations()[row], false);
+        }
+    }
+
+    painter.restore();
+}
+
+void SceneRenderer::paintSelection(QPainter &painter, const Project &project, const View &view, const QRect &rect,
+                                   const QList<int> &selectedWalls)
+{
+    painter.save();
+    beginWorld(painter, view);
+
+    QRectF area = view.mapToWorld(rect).adjusted(-PAINT_MARGIN, -PAINT_MARGIN, PAINT_MARGIN, PAINT_MARGIN);
+
+    for (int i : selectedWalls) {
+        if (i < 0 || i >= project.walls().size()) continue;
+
+        const Wall &wall = project.walls()[i];
+        if (!Project::wallBounds(wall).intersects(area)) continue;
+
+        painter.setPen(QPen(Qt::cyan, 5, Qt::SolidLine, Qt::RoundCap));
+        wall.draw(painter);
+
+        painter.setPen(QPen(Qt::black, 3, Qt::SolidLine, Qt::RoundCap));
+        wall.draw(painter);
+    }
+
+    // Last, so dragged items stay on top
+    const FurnitureStore &store = project.furnitureStore();
+    for (int row : project.furnitureRowsIn(area)) {
+        if (store.isSelected(row)) {
+            m_sprites.draw(painter, store.types()[row], store.positions()[row], store.rotations()[row], true);
+        }
+    }
+
+    painter.restore();
+}
+
+void SceneRenderer::paintWallPreview(QPainter &painter, const View &view, const QLine &wall,
+                                     const WallSnapper::Result &snap, const QRectF &marker) const
+{
+    painter.save();
+    beginWorld(painter, view);
+
+    painter.setOpacity(0.5);
+    painter.setPen(QPen(Qt::black, 5, Qt::SolidLine, Qt::RoundCap));
+    painter.drawLine(wall);
+    painter.setOpacity(1);
+
+    if (snap.isValid()) {
+        painter.setPen(QPen(QColor(255, 140, 0), 2 / view.zoom));
+        painter.setBrush(Qt::NoBrush);
+
+        switch (snap.kind) {
+        case WallSnapper::Kind::Endpoint:
+            painter.drawRect(marker);
+            break;
+        case WallSnapper::Kind::Midpoint:
+            {
+                const QPointF triangle[3] = { QPointF(marker.center().x(), marker.top()),
+                                              marker.bottomRight(), marker.bottomLeft() };
+                painter.drawPolygon(triangle, 3);
+            }
+            break;
+        case WallSnapper::Kind::Perpendicular:
+            painter.drawLine(marker.bottomLeft(), marker.bottomRight());
+            painter.drawLine(QPointF(marker.center().x(), marker.top()), QPointF(marker.center().x(), marker.bottom()));
+            break;
+        default:
+            break;
+        }
+    }
+
+    painter.restore();
+}
+
+void SceneRenderer::paint(QPainter &painter, const Project &project, const View &view, const QRect &rect,
+                          const QList<int> &selectedWalls)
+{
+    paintGrid(painter, project, view, rect);
+    paintWalls(painter, project, view, rect);
+    paintFurniture(painter, project, view, rect);
+    paintSelection(painter, project, view, rect, selectedWalls);
+}
@@ -0,0 +1,61 @@
+#ifndef SCENERENDERER_H
+#define SCENERENDERER_H
+
+#include "project.h"
+#include "spritecache.h"
+#include "wallsnapper.h"
+#include <QLine>
+#include <QPainter>
+#include <QRect>
+#include <QTransform>
+
+
+// Paints a project the way DesignArea shows it, onto any QPaintDevice: the
+// widget, its cached background or an offscreen QImage. Every layer only
+// draws what falls inside the given device rect.
+class SceneRenderer {
+public:
+    // Device = (plan - origin) * zoom
+    struct View {
+        qreal zoom = 1;
+        QPointF origin;
+
+        QTransform transform() const;
+        QPointF mapToWorld(const QPointF &devicePos) const;
+        QRectF mapToWorld(const QRect &deviceRect) const;
+    };
+
+    // Plan rects are grown by this much to cover pen widths and antialiasing
+    static constexpr int PAINT_MARGIN = 4;
+
+    SceneRenderer();
+
+    bool antialiasing() const;
+    void setAntialiasing(bool enabled);
+
+    void clearSprites();
+
+    // Background outside the canvas, the canvas and its grid
+    void paintGrid(QPainter &painter, const Project &project, const View &view, const QRect &rect) const;
+    void paintWalls(QPainter &painter, const Project &project, const View &view, const QRect &rect) const;
+    // Furniture that is not selected
+    void paintFurniture(QPainter &painter, const Project &project, const View &view, const QRect &rect);
+    // Highlighted walls and selected furniture, on top of everything else
+    void paintSelection(QPainter &painter, const Project &project, const View &view, const QRect &rect,
+                        const QList<int> &selectedWalls);
+    // Wall being drawn with the wall tool, and its snap target
+    void paintWallPreview(QPainter &painter, const View &view, const QLine &wall,
+                          const WallSnapper::Result &snap, const QRectF &marker) const;
+
+    // All layers above except the wall preview, as a full repaint
+    void paint(QPainter &painter, const Project &project, const View &view, const QRect &rect,
+               const QList<int> &selectedWalls);
+
+private:
+    FurnitureSpriteCache m_sprites;
+    bool m_antialiasing;
+
+    void beginWorld(QPainter &painter, const View &view) const;
+};
+
+#endif // SCENERENDERER_H
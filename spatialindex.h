@@ -0,0 +1,226 @@
+#ifndef SPATIALINDEX_H
+#define SPATIALINDEX_H
+
+#include <QHash>
+#include <QList>
+#include <QRectF>
+
+#include <array>
+#include <memory>
+
+
+// Loose quadtree keyed by item. A node's loose bounds reach half its size past
+// its edges, so an item goes down into the quadrant holding its center for as
+// long as it fits that quadrant's loose bounds. Items lying across a split line
+// therefore do not pile up in the ancestors. Items too large for any quadrant,
+// or outside the root bounds, stay in the root.
+template <typename T>
+class SpatialIndex {
+public:
+    explicit SpatialIndex(const QRectF &bounds = QRectF(), int maxDepth = 8, int nodeCapacity = 8)
+        : m_root(new Node(bounds, 0)), m_maxDepth(maxDepth), m_nodeCapacity(nodeCapacity) {}
+
+    void reset(const QRectF &bounds)
+    {
+        m_root.reset(new Node(bounds, 0));
+        m_rects.clear();
+    }
+
+    void clear()
+    {
+        reset(m_root->bounds);
+    }
+
+    QRectF bounds() const
+    {
+        return m_root->bounds;
+    }
+
+    int size() const
+    {
+        return m_rects.size();
+    }
+
+    bool contains(const T &item) const
+    {
+        return m_rects.contains(item);
+    }
+
+    QRectF rect(const T &item) const
+    {
+        return m_rects.value(item);
+    }
+
+    void insert(const T &item, const QRectF &rect)
+    {
+        if (m_rects.contains(item)) {
+            remove(item);
+        }
+
+        m_rects.insert(item, rect);
+        insertInto(m_root.get(), item, rect);
+    }
+
+    bool remove(const T &item)
+    {
+        auto it = m_rects.find(item);
+        if (it == m_rects.end()) return false;
+
+        QRectF rect = it.value();
+        m_rects.erase(it);
+
+        return removeFrom(m_root.get(), item, rect);
+    }
+
+    void update(const T &item, const QRectF &rect)
+    {
+        auto it = m_rects.find(item);
+        if (it != m_rects.end() && it.value() == rect) return;
+
+        insert(item, rect);
+    }
+
+    // Candidates whose stored rect touches the given rect, edges included.
+    QList<T> query(const QRectF &rect) const
+    {
+        QList<T> result;
+        queryNode(m_root.get(), rect, result);
+
+        return result;
+    }
+
+    QList<T> query(const QPointF &point) const
+    {
+        return query(QRectF(point, QSizeF(0, 0)));
+    }
+
+private:
+    struct Entry {
+        T item;
+        QRectF rect;
+    };
+
+    struct Node {
+        Node(const QRectF &bounds, int depth)
+            : bounds(bounds),
+              looseBounds(bounds.adjusted(-bounds.width() / 2, -bounds.height() / 2,
+                                          bounds.width() / 2, bounds.height() / 2)),
+              depth(depth) {}
+
+        QRectF bounds;
+        QRectF looseBounds;
+        int depth;
+        QList<Entry> entries;
+        std::array<std::unique_ptr<Node>, 4> children;
+
+        bool isLeaf() const
+        {
+            return !children[0];
+        }
+    };
+
+    std::unique_ptr<Node> m_root;
+    QHash<T, QRectF> m_rects;
+    int m_maxDepth;
+    int m_nodeCapacity;
+
+    static bool touches(const QRectF &a, const QRectF &b)
+    {
+        // Inclusive test so degenerate (point or line) rects are still found.
+        return a.left() <= b.right() && b.left() <= a.right() &&
+               a.top() <= b.bottom() && b.top() <= a.bottom();
+    }
+
+    static bool encloses(const QRectF &outer, const QRectF &inner)
+    {
+        return inner.left() >= outer.left() && inner.right() <= outer.right() &&
+               inner.top() >= outer.top() && inner.bottom() <= outer.bottom();
+    }
+
+    Node *childFor(Node *node, const QRectF &rect) const
+    {
+        if (node->isLeaf()) return nullptr;
+
+        QPointF center = rect.center();
+        QPointF middle = node->bounds.center();
+        int quadrant = (center.x() < middle.x() ? 0 : 1) + (center.y() < middle.y() ? 0 : 2);
+
+        Node *child = node->children[quadrant].get();
+        return encloses(child->looseBounds, rect) ? child : nullptr;
+    }
+
+    void split(Node *node)
+    {
+        const QRectF &b = node->bounds;
+        qreal halfWidth = b.width() / 2;
+        qreal halfHeight = b.height() / 2;
+
+        node->children[0].reset(new Node(QRectF(b.left(), b.top(), halfWidth, halfHeight), node->depth + 1));
+        node->children[1].reset(new Node(QRectF(b.left() + halfWidth, b.top(), halfWidth, halfHeight), node->depth + 1));
+        node->children[2].reset(new Node(QRectF(b.left(), b.top() + halfHeight, halfWidth, halfHeight), node->depth + 1));
+        node->children[3].reset(new Node(QRectF(b.left() + halfWidth, b.top() + halfHeight, halfWidth, halfHeight), node->depth + 1));
+
+        // Push down everything that now fits into a single quadrant
+        QList<Entry> remaining;
+        for (const Entry &entry : node->entries) {
+            Node *child = childFor(node, entry.rect);
+            if (child) {
+                insertInto(child, entry.item, entry.rect);
+            }
+            else {
+                remaining.append(entry);
+            }
+        }
+
+        node->entries = remaining;
+    }
+
+    void insertInto(Node *node, const T &item, const QRectF &rect)
+    {
+        while (Node *child = childFor(node, rect)) {
+            node = child;
+        }
+
+        node->entries.append(Entry{item, rect});
+
+        if (node->isLeaf() && node->entries.size() > m_nodeCapacity && node->depth < m_maxDepth
+            && !node->bounds.isEmpty()) {
+            split(node);
+        }
+    }
+
+    bool removeFrom(Node *node, const T &item, const QRectF &rect)
+    {
+        while (node) {
+            for (int i = 0; i < node->entries.size(); ++i) {
+                if (node->entries[i].item == item) {
+                    node->entries.removeAt(i);
+                    return true;
+                }
+            }
+
+            node = childFor(node, rect);
+        }
+
+        return false;
+    }
+
+    void queryNode(const Node *node, const QRectF &rect, QList<T> &result) const
+    {
+        for (const Entry &entry : node->entries) {
+            if (touches(entry.rect, rect)) {
+                result.append(entry.item);
+            }
+        }
+
+        if (node->isLeaf()) return;
+
+        for (const std::unique_ptr<Node> &child : node->children) {
+            if (touches(child->looseBounds, rect)) {
+                queryNode(child.get(), rect, result);
+            }
+        }
+    }
+};
+
+#endif // SPATIALINDEX_H
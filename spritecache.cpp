@@ -0,0 +1,112 @@
+#include "spritecache.h"
+
+#include <QtMath>
+
+
+FurnitureSpriteCache::FurnitureSpriteCache(int maxKilobytes) : m_sprites(maxKilobytes), m_antialiasing(true) {}
+
+void FurnitureSpriteCache::clear()
+{
+    m_sprites.clear();
+}
+
+void FurnitureSpriteCache::setAntialiasing(bool enabled)
+{
+    if (enabled != m_antialiasing) {
+        m_antialiasing = enabled;
+        m_sprites.clear();
+    }
+}
+
+void FurnitureSpriteCache::draw(QPainter &painter, const Furniture &item)
+{
+    draw(painter, item.type(), item.position(), item.rotation(), item.isSelected());
+}
+
+void FurnitureSpriteCache::draw(QPainter &painter, FurnitureType type, const QPointF &position, qreal rotation,
+                                bool selected)
+{
+    QTransform transform = painter.transform();
+    qreal scale = transform.m11();
+
+    // Rotated or sheared painters can't use the sprites
+    if (transform.isRotating() || scale <= 0) {
+        drawDirect(painter, type, position, rotation, selected);
+        return;
+    }
+
+    qreal pixelRatio = painter.device()->devicePixelRatioF();
+    quint64 key = keyFor(type, rotation, selected, scale * pixelRatio);
+
+    QPixmap *sprite = m_sprites.object(key);
+    if (!sprite) {
+        sprite = new QPixmap(render(type, rotation, selected, scale, pixelRatio, m_antialiasing));
+        int cost = qMax(1, int(sprite->width() * sprite->height() * 4 / 1024));
+
+        if (!m_sprites.insert(key, sprite, cost)) {
+            // Larger than the whole cache, draw it directly
+            drawDirect(painter, type, position, rotation, selected);
+            return;
+        }
+    }
+
+    QPointF center = transform.map(position);
+    QSizeF size = QSizeF(sprite->size()) / pixelRatio;
+
+    painter.save();
+    painter.resetTransform();
+    painter.drawPixmap(QPointF(center.x() - size.width() / 2, center.y() - size.height() / 2), *sprite);
+    painter.restore();
+}
+
+quint64 FurnitureSpriteCache::keyFor(FurnitureType type, qreal rotation, bool selected, qreal scale)
+{
+    quint64 typeBits = quint64(type) & 0x3;
+    quint64 selectedBit = selected ? 1 : 0;
+    quint64 rotationBits = quint64(qRound(rotation * 64)) & 0xFFFF;
+    quint64 zoom = quint64(qRound(scale * 1024)) & 0xFFFFFFFF;
+
+    return typeBits | (selectedBit << 2) | (rotationBits << 3) | (zoom << 19);
+}
+
+QPixmap FurnitureSpriteCache::render(FurnitureType type, qreal rotation, bool selected, qreal scale,
+                                     qreal pixelRatio, bool antialiasing)
+{
+    // A stand-in at the origin, every item of the type looks the same
+    Furniture *item = Furniture::create(type, QPointF(0, 0));
+    item->setRotation(rotation);
+    item->setSelected(selected);
+
+    // Room for the rotated shape plus the selection pen and antialiasing
+    const int SPRITE_MARGIN = 3;
+    QRectF bounds = item->rotatedBoundingRect();
+
+    int logicalWidth = qCeil(bounds.width() * scale) + 2 * SPRITE_MARGIN;
+    int logicalHeight = qCeil(bounds.height() * scale) + 2 * SPRITE_MARGIN;
+
+    QPixmap sprite(qCeil(logicalWidth * pixelRatio), qCeil(logicalHeight * pixelRatio));
+    sprite.setDevicePixelRatio(pixelRatio);
+    sprite.fill(Qt::transparent);
+
+    QPainter painter(&sprite);
+    painter.setRenderHint(QPainter::Antialiasing, antialiasing);
+    painter.translate(logicalWidth / 2.0, logicalHeight / 2.0);
+    painter.scale(scale, scale);
+    item->draw(painter);
+    painter.end();
+
+    delete item;
+
+    return sprite;
+}
+
+void FurnitureSpriteCache::drawDirect(QPainter &painter, FurnitureType type, const QPointF &position,
+                                      qreal rotation, bool selected)
+{
+    Furniture *item = Furniture::create(type, position);
+    item->setRotation(rotation);
+    item->setSelected(selected);
+    item->draw(painter);
+
+    delete item;
+}
@@ -0,0 +1,39 @@
+#ifndef SPRITECACHE_H
+#define SPRITECACHE_H
+
+#include "furniture.h"
+#include <QCache>
+#include <QPainter>
+#include <QPixmap>
+
+
+// Pre-rendered furniture glyphs. Every instance of a type looks the same, so
+// one pixmap per (type, rotation, selected, scale) is blitted for all of them.
+class FurnitureSpriteCache {
+public:
+    explicit FurnitureSpriteCache(int maxKilobytes = 32 * 1024);
+
+    void clear();
+
+    // Sprites are rendered with antialiasing unless turned off
+    void setAntialiasing(bool enabled);
+
+    // Draws the item at its position through the painter's current transform,
+    // which is expected to be a plain scale and translation.
+    void draw(QPainter &painter, const Furniture &item);
+
+    // The same from a row of a FurnitureStore, without a Furniture object
+    void draw(QPainter &painter, FurnitureType type, const QPointF &position, qreal rotation, bool selected);
+
+private:
+    QCache<quint64, QPixmap> m_sprites;
+    bool m_antialiasing;
+
+    static quint64 keyFor(FurnitureType type, qreal rotation, bool selected, qreal scale);
+    static QPixmap render(FurnitureType type, qreal rotation, bool selected, qreal scale, qreal pixelRatio,
+                          bool antialiasing);
+    static void drawDirect(QPainter &painter, FurnitureType type, const QPointF &position, qreal rotation,
+                           bool selected);
+};
+
+#endif // SPRITECACHE_H
@@ -0,0 +1,132 @@
+#include "project.h"
+#include "projectgenerator.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QTextStream>
+
+
+static bool parseSize(const QString &text, QSize &size)
+{
+    QStringList parts = text.split(QLatin1Char('x'));
+    if (parts.size() != 2) return false;
+
+    bool widthOk = false;
+    bool heightOk = false;
+    size = QSize(parts[0].toInt(&widthOk), parts[1].toInt(&heightOk));
+
+    return widthOk && heightOk && size.width() > 0 && size.height() > 0;
+}
+
+static bool parseMix(const QString &text, ProjectGenerator::Parameters &parameters)
+{
+    QStringList parts = text.split(QLatin1Char(':'));
+    if (parts.size() != 3) return false;
+
+    bool ok[3] = { false, false, false };
+    parameters.sofaWeight = parts[0].toDouble(&ok[0]);
+    parameters.chairWeight = parts[1].toDouble(&ok[1]);
+    parameters.tableWeight = parts[2].toDouble(&ok[2]);
+
+    return ok[0] && ok[1] && ok[2];
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("houseplanner_generate");
+
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Writes a synthetic House Planner project for scale and stress tests.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("output", "Project file to write (.bruh).");
+
+    QCommandLineOption wallsOption("walls", "Number of walls.", "count", "400");
+    QCommandLineOption furnitureOption("furniture", "Number of furniture items.", "count", "5000");
+    QCommandLineOption mixOption("mix", "Relative share of sofas, chairs and tables.", "sofa:chair:table", "1:4:1");
+    QCommandLineOption densityOption("density", "Share of the rooms that get furniture, 0 to 1.", "share", "1");
+    QCommandLineOption rotationOption("rotation", "Rotations used: none, right, octants or uniform.", "mode", "right");
+    QCommandLineOption canvasOption("canvas", "Canvas size.", "WxH", "10000x10000");
+    QCommandLineOption seedOption("seed", "Random seed; the same seed gives the same project.", "seed", "1");
+    QCommandLineOption attemptsOption("attempts", "Free spots tried per item before it is placed overlapping.", "count", "20");
+    QCommandLineOption compressOption("compress", "Write the compressed format.");
+
+    parser.addOptions({ wallsOption, furnitureOption, mixOption, densityOption, rotationOption,
+                        canvasOption, seedOption, attemptsOption, compressOption });
+    parser.process(app);
+
+    const QStringList positional = parser.positionalArguments();
+    if (positional.size() != 1) {
+        parser.showHelp(1);
+    }
+
+    ProjectGenerator::Parameters parameters;
+    bool ok = true;
+    bool valueOk = false;
+
+    parameters.wallCount = parser.value(wallsOption).toInt(&valueOk);
+    ok = ok && valueOk && parameters.wallCount >= 0;
+
+    parameters.furnitureCount = parser.value(furnitureOption).toInt(&valueOk);
+    ok = ok && valueOk && parameters.furnitureCount >= 0;
+
+    parameters.density = parser.value(densityOption).toDouble(&valueOk);
+    ok = ok && valueOk && parameters.density >= 0 && parameters.density <= 1;
+
+    parameters.seed = parser.value(seedOption).toUInt(&valueOk);
+    ok = ok && valueOk;
+
+    parameters.placementAttempts = parser.value(attemptsOption).toInt(&valueOk);
+    ok = ok && valueOk && parameters.placementAttempts > 0;
+
+    ok = ok && parseMix(parser.value(mixOption), parameters);
+    ok = ok && parseSize(parser.value(canvasOption), parameters.canvasSize);
+
+    const QString rotation = parser.value(rotationOption);
+    if (rotation == "none") {
+        parameters.rotation = ProjectGenerator::Rotation::None;
+    }
+    else if (rotation == "right") {
+        parameters.rotation = ProjectGenerator::Rotation::RightAngles;
+    }
+    else if (rotation == "octants") {
+        parameters.rotation = ProjectGenerator::Rotation::Octants;
+    }
+    else if (rotation == "uniform") {
+        parameters.rotation = ProjectGenerator::Rotation::Uniform;
+    }
+    else {
+        ok = false;
+    }
+
+    if (!ok) {
+        err << "Invalid option value, see --help" << Qt::endl;
+        return 1;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    Project project;
+    ProjectGenerator::Result result = ProjectGenerator::generate(project, parameters);
+    qint64 generateTime = timer.restart();
+
+    ProjectFormat::Encoding encoding = parser.isSet(compressOption) ? ProjectFormat::Encoding::Compressed
+                                                                    : ProjectFormat::Encoding::Plain;
+    if (!project.save(positional.first(), encoding)) {
+        err << "Could not write " << positional.first() << Qt::endl;
+        return 1;
+    }
+
+    QSize canvas = project.getCanvasSize();
+    out << positional.first() << ": " << canvas.width() << "x" << canvas.height() << ", "
+        << result.walls << " walls, " << result.furniture << " furniture ("
+        << result.overlapping << " overlapping)" << Qt::endl;
+    out << "Generated in " << generateTime << " ms, saved in " << timer.elapsed() << " ms" << Qt::endl;
+
+    return 0;
+}
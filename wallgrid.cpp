@@ -0,0 +1,182 @@
+#include "wallgrid.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+
+WallGrid::WallGrid(qreal cellSize) : m_cellSize(cellSize), m_size(0) {}
+
+qreal WallGrid::cellSize() const
+{
+    return m_cellSize;
+}
+
+int WallGrid::size() const
+{
+    return m_size;
+}
+
+void WallGrid::clear()
+{
+    m_cells.clear();
+    m_oversized.clear();
+    m_size = 0;
+}
+
+void WallGrid::rebuild(const QList<Wall> &walls)
+{
+    clear();
+
+    for (int i = 0; i < walls.size(); ++i) {
+        insert(i, walls[i]);
+    }
+}
+
+void WallGrid::insert(int index, const Wall &wall)
+{
+    QVector<quint64> cells = cellsFor(wall);
+    if (cells.isEmpty()) {
+        m_oversized.insert(index, QRectF(wall.startPoint(), wall.endPoint()).normalized());
+    }
+
+    for (quint64 key : cells) {
+        m_cells[key].append(index);
+    }
+
+    ++m_size;
+}
+
+void WallGrid::remove(int index, const Wall &wall)
+{
+    QVector<quint64> cells = cellsFor(wall);
+    if (cells.isEmpty()) {
+        m_oversized.remove(index);
+    }
+
+    for (quint64 key : cells) {
+        auto it = m_cells.find(key);
+        if (it == m_cells.end()) continue;
+
+        it.value().removeOne(index);
+        if (it.value().isEmpty()) {
+            m_cells.erase(it);
+        }
+    }
+
+    --m_size;
+}
+
+QList<int> WallGrid::query(const QRectF &rect) const
+{
+    QList<int> result;
+    QRectF r = rect.normalized();
+
+    for (auto it = m_oversized.constBegin(); it != m_oversized.constEnd(); ++it) {
+        const QRectF &bounds = it.value();
+        if (bounds.left() <= r.right() && r.left() <= bounds.right() &&
+            bounds.top() <= r.bottom() && r.top() <= bounds.bottom()) {
+            result.append(it.key());
+        }
+    }
+
+    if (m_cells.isEmpty()) {
+        std::sort(result.begin(), result.end());
+        return result;
+    }
+
+    int left = cellCoordinate(r.left());
+    int right = cellCoordinate(r.right());
+    int top = cellCoordinate(r.top());
+    int bottom = cellCoordinate(r.bottom());
+
+    qint64 cellCount = (qint64(right) - left + 1) * (qint64(bottom) - top + 1);
+
+    if (cellCount <= m_cells.size()) {
+        for (qint64 y = top; y <= bottom; ++y) {
+            for (qint64 x = left; x <= right; ++x) {
+                auto it = m_cells.constFind(cellKey(int(x), int(y)));
+                if (it != m_cells.constEnd()) {
+                    result.append(it.value());
+                }
+            }
+        }
+    }
+    else {
+        // Large areas (zoomed out views) touch more cells than are occupied
+        for (auto it = m_cells.constBegin(); it != m_cells.constEnd(); ++it) {
+            int x = qint32(it.key() >> 32);
+            int y = qint32(it.key() & 0xffffffff);
+
+            if (x >= left && x <= right && y >= top && y <= bottom) {
+                result.append(it.value());
+            }
+        }
+    }
+
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+
+    return result;
+}
+
+int WallGrid::cellCoordinate(qreal value) const
+{
+    qreal cell = std::floor(value / m_cellSize);
+
+    return int(qBound<qreal>(std::numeric_limits<int>::min(), cell, std::numeric_limits<int>::max()));
+}
+
+QVector<quint64> WallGrid::cellsFor(const Wall &wall) const
+{
+    QVector<quint64> cells;
+
+    QPointF start = wall.startPoint();
+    QPointF end = wall.endPoint();
+    if (start.y() > end.y()) {
+        std::swap(start, end);
+    }
+
+    qreal dx = end.x() - start.x();
+    qreal dy = end.y() - start.y();
+
+    // Slightly widened so cells the segment only touches are not missed to rounding
+    const qreal slack = m_cellSize * 1e-6;
+
+    int firstRow = cellCoordinate(start.y());
+    int lastRow = cellCoordinate(end.y());
+
+    // A segment passes through at most one cell per row plus one per column
+    qint64 rows = qint64(lastRow) - firstRow + 1;
+    qint64 columns = qAbs(qint64(cellCoordinate(end.x())) - cellCoordinate(start.x())) + 1;
+    if (rows + columns > MAX_WALL_CELLS) return cells;
+
+    // 64-bit so the loops end at the edge of the int range
+    for (qint64 row = firstRow; row <= lastRow; ++row) {
+        qreal x1 = start.x();
+        qreal x2 = end.x();
+
+        if (dy != 0) {
+            // Part of the segment inside this row
+            qreal y1 = qMax(start.y(), row * m_cellSize);
+            qreal y2 = qMin(end.y(), (row + 1) * m_cellSize);
+
+            x1 = start.x() + (y1 - start.y()) * dx / dy;
+            x2 = start.x() + (y2 - start.y()) * dx / dy;
+        }
+
+        int firstColumn = cellCoordinate(qMin(x1, x2) - slack);
+        int lastColumn = cellCoordinate(qMax(x1, x2) + slack);
+
+        for (qint64 column = firstColumn; column <= lastColumn; ++column) {
+            cells.append(cellKey(int(column), int(row)));
+        }
+    }
+
+    return cells;
+}
+
+quint64 WallGrid::cellKey(int x, int y)
+{
+    return (quint64(quint32(x)) << 32) | quint32(y);
+}
@@ -0,0 +1,47 @@
+#ifndef WALLGRID_H
+#define WALLGRID_H
+
+#include "wall.h"
+#include <QHash>
+#include <QList>
+#include <QRectF>
+#include <QVector>
+
+
+// Uniform grid hash over wall segments. A wall is stored in every cell its
+// segment passes through, not in every cell of its bounding box, so long
+// diagonal walls stay cheap and a point query only looks at one cell. Walls
+// crossing more than MAX_WALL_CELLS cells, e.g. from a damaged file, are kept
+// in a plain list instead so they cannot flood the grid.
+class WallGrid {
+public:
+    explicit WallGrid(qreal cellSize = DEFAULT_CELL_SIZE);
+
+    qreal cellSize() const;
+    int size() const;
+
+    void clear();
+    void rebuild(const QList<Wall> &walls);
+    void insert(int index, const Wall &wall);
+    void remove(int index, const Wall &wall);
+
+    // Walls whose segment may touch the rect, edges included. Ascending, no duplicates.
+    QList<int> query(const QRectF &rect) const;
+
+    static constexpr qreal DEFAULT_CELL_SIZE = 64;
+    static const int MAX_WALL_CELLS = 4096;
+
+private:
+    qreal m_cellSize;
+    QHash<quint64, QVector<int>> m_cells;
+    QHash<int, QRectF> m_oversized;
+    int m_size;
+
+    int cellCoordinate(qreal value) const;
+    // Empty for walls that go into m_oversized
+    QVector<quint64> cellsFor(const Wall &wall) const;
+
+    static quint64 cellKey(int x, int y);
+};
+
+#endif // WALLGRID_H
@@ -0,0 +1,342 @@
+#include "wallkernel.h"
+
+#include <QVarLengthArray>
+
+#include <cmath>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define WALLKERNEL_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define WALLKERNEL_SSE2
+#endif
+
+
+namespace {
+
+// A rect edge as QLineF(p1, p2), with b = p1 - p2 precomputed
+struct Edge {
+    double x1;
+    double y1;
+    double bx;
+    double by;
+};
+
+// Inclusive bounds used by QRectF::contains(), empty if the rect is null
+struct Bounds {
+    double left;
+    double right;
+    double top;
+    double bottom;
+    bool empty;
+};
+
+struct Box {
+    Edge edges[4];
+    Bounds bounds;
+};
+
+Box makeBox(const QRectF &rect)
+{
+    // Same edges and direction as Wall::intersects()
+    const QPointF corners[5] = {
+        rect.topLeft(), rect.topRight(), rect.bottomRight(), rect.bottomLeft(), rect.topLeft()
+    };
+
+    Box box;
+    for (int i = 0; i < 4; ++i) {
+        box.edges[i].x1 = corners[i].x();
+        box.edges[i].y1 = corners[i].y();
+        box.edges[i].bx = corners[i].x() - corners[i + 1].x();
+        box.edges[i].by = corners[i].y() - corners[i + 1].y();
+    }
+
+    double left = rect.x();
+    double right = rect.x();
+    if (rect.width() < 0) left += rect.width(); else right += rect.width();
+
+    double top = rect.y();
+    double bottom = rect.y();
+    if (rect.height() < 0) top += rect.height(); else bottom += rect.height();
+
+    box.bounds = Bounds{left, right, top, bottom, left == right || top == bottom};
+
+    return box;
+}
+
+bool intersectsScalar(const Box &box, double x1, double y1, double x2, double y2)
+{
+    const double ax = x2 - x1;
+    const double ay = y2 - y1;
+
+    for (const Edge &edge : box.edges) {
+        const double cx = x1 - edge.x1;
+        const double cy = y1 - edge.y1;
+
+        const double denominator = ay * edge.bx - ax * edge.by;
+        if (denominator == 0 || !std::isfinite(denominator)) continue;
+
+        const double reciprocal = 1 / denominator;
+        const double na = (edge.by * cx - edge.bx * cy) * reciprocal;
+        if (na < 0 || na > 1) continue;
+
+        const double nb = (ax * cy - ay * cx) * reciprocal;
+        if (nb < 0 || nb > 1) continue;
+
+        return true;
+    }
+
+    const Bounds &b = box.bounds;
+    if (b.empty) return false;
+
+    return !(x1 < b.left || x1 > b.right || y1 < b.top || y1 > b.bottom) &&
+           !(x2 < b.left || x2 > b.right || y2 < b.top || y2 > b.bottom);
+}
+
+#if defined(WALLKERNEL_AVX)
+
+const int LANES = 4;
+
+int intersectsVector(const Box &box, const qint32 *x1, const qint32 *y1,
+                     const qint32 *x2, const qint32 *y2, int count, quint8 *result)
+{
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d one = _mm256_set1_pd(1.0);
+
+    int i = 0;
+    for (; i + LANES <= count; i += LANES) {
+        const __m256d px1 = _mm256_cvtepi32_pd(_mm_loadu_si128(reinterpret_cast<const __m128i*>(x1 + i)));
+        const __m256d py1 = _mm256_cvtepi32_pd(_mm_loadu_si128(reinterpret_cast<const __m128i*>(y1 + i)));
+        const __m256d px2 = _mm256_cvtepi32_pd(_mm_loadu_si128(reinterpret_cast<const __m128i*>(x2 + i)));
+        const __m256d py2 = _mm256_cvtepi32_pd(_mm_loadu_si128(reinterpret_cast<const __m128i*>(y2 + i)));
+
+        const __m256d ax = _mm256_sub_pd(px2, px1);
+        const __m256d ay = _mm256_sub_pd(py2, py1);
+
+        __m256d hit = zero;
+
+        for (const Edge &edge : box.edges) {
+            const __m256d bx = _mm256_set1_pd(edge.bx);
+            const __m256d by = _mm256_set1_pd(edge.by);
+            const __m256d cx = _mm256_sub_pd(px1, _mm256_set1_pd(edge.x1));
+            const __m256d cy = _mm256_sub_pd(py1, _mm256_set1_pd(edge.y1));
+
+            const __m256d denominator = _mm256_sub_pd(_mm256_mul_pd(ay, bx), _mm256_mul_pd(ax, by));
+            const __m256d reciprocal = _mm256_div_pd(one, denominator);
+            const __m256d na = _mm256_mul_pd(_mm256_sub_pd(_mm256_mul_pd(by, cx), _mm256_mul_pd(bx, cy)), reciprocal);
+            const __m256d nb = _mm256_mul_pd(_mm256_sub_pd(_mm256_mul_pd(ax, cy), _mm256_mul_pd(ay, cx)), reciprocal);
+
+            // Unordered predicates, a NaN ratio is not rejected by the scalar code either
+            __m256d bounded = _mm256_and_pd(_mm256_cmp_pd(denominator, zero, _CMP_NEQ_OQ),
+                                            _mm256_cmp_pd(_mm256_sub_pd(denominator, denominator), zero, _CMP_EQ_OQ));
+            bounded = _mm256_and_pd(bounded, _mm256_cmp_pd(na, zero, _CMP_NLT_UQ));
+            bounded = _mm256_and_pd(bounded, _mm256_cmp_pd(na, one, _CMP_NGT_UQ));
+            bounded = _mm256_and_pd(bounded, _mm256_cmp_pd(nb, zero, _CMP_NLT_UQ));
+            bounded = _mm256_and_pd(bounded, _mm256_cmp_pd(nb, one, _CMP_NGT_UQ));
+
+            hit = _mm256_or_pd(hit, bounded);
+        }
+
+        const Bounds &b = box.bounds;
+        if (!b.empty) {
+            const __m256d left = _mm256_set1_pd(b.left);
+            const __m256d right = _mm256_set1_pd(b.right);
+            const __m256d top = _mm256_set1_pd(b.top);
+            const __m256d bottom = _mm256_set1_pd(b.bottom);
+
+            // Negated unordered compares, so NaN bounds behave as in intersectsScalar()
+            __m256d inside = _mm256_and_pd(_mm256_cmp_pd(px1, left, _CMP_NLT_UQ), _mm256_cmp_pd(px1, right, _CMP_NGT_UQ));
+            inside = _mm256_and_pd(inside, _mm256_and_pd(_mm256_cmp_pd(py1, top, _CMP_NLT_UQ), _mm256_cmp_pd(py1, bottom, _CMP_NGT_UQ)));
+            inside = _mm256_and_pd(inside, _mm256_and_pd(_mm256_cmp_pd(px2, left, _CMP_NLT_UQ), _mm256_cmp_pd(px2, right, _CMP_NGT_UQ)));
+            inside = _mm256_and_pd(inside, _mm256_and_pd(_mm256_cmp_pd(py2, top, _CMP_NLT_UQ), _mm256_cmp_pd(py2, bottom, _CMP_NGT_UQ)));
+
+            hit = _mm256_or_pd(hit, inside);
+        }
+
+        const int mask = _mm256_movemask_pd(hit);
+        for (int lane = 0; lane < LANES; ++lane) {
+            result[i + lane] = (mask >> lane) & 1;
+        }
+    }
+
+    return i;
+}
+
+#elif defined(WALLKERNEL_SSE2)
+
+const int LANES = 2;
+
+int intersectsVector(const Box &box, const qint32 *x1, const qint32 *y1,
+                     const qint32 *x2, const qint32 *y2, int count, quint8 *result)
+{
+    const __m128d zero = _mm_setzero_pd();
+    const __m128d one = _mm_set1_pd(1.0);
+
+    int i = 0;
+    for (; i + LANES <= count; i += LANES) {
+        const __m128d px1 = _mm_cvtepi32_pd(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(x1 + i)));
+        const __m128d py1 = _mm_cvtepi32_pd(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(y1 + i)));
+        const __m128d px2 = _mm_cvtepi32_pd(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(x2 + i)));
+        const __m128d py2 = _mm_cvtepi32_pd(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(y2 + i)));
+
+        const __m128d ax = _mm_sub_pd(px2, px1);
+        const __m128d ay = _mm_sub_pd(py2, py1);
+
+        __m128d hit = zero;
+
+        for (const Edge &edge : box.edges) {
+            const __m128d bx = _mm_set1_pd(edge.bx);
+            const __m128d by = _mm_set1_pd(edge.by);
+            const __m128d cx = _mm_sub_pd(px1, _mm_set1_pd(edge.x1));
+            const __m128d cy = _mm_sub_pd(py1, _mm_set1_pd(edge.y1));
+
+            const __m128d denominator = _mm_sub_pd(_mm_mul_pd(ay, bx), _mm_mul_pd(ax, by));
+            const __m128d reciprocal = _mm_div_pd(one, denominator);
+            const __m128d na = _mm_mul_pd(_mm_sub_pd(_mm_mul_pd(by, cx), _mm_mul_pd(bx, cy)), reciprocal);
+            const __m128d nb = _mm_mul_pd(_mm_sub_pd(_mm_mul_pd(ax, cy), _mm_mul_pd(ay, cx)), reciprocal);
+
+            // Unordered predicates, a NaN ratio is not rejected by the scalar code either
+            __m128d bounded = _mm_and_pd(_mm_cmpneq_pd(denominator, zero),
+                                         _mm_cmpeq_pd(_mm_sub_pd(denominator, denominator), zero));
+            bounded = _mm_and_pd(bounded, _mm_cmpnlt_pd(na, zero));
+            bounded = _mm_and_pd(bounded, _mm_cmpngt_pd(na, one));
+            bounded = _mm_and_pd(bounded, _mm_cmpnlt_pd(nb, zero));
+            bounded = _mm_and_pd(bounded, _mm_cmpngt_pd(nb, one));
+
+            hit = _mm_or_pd(hit, bounded);
+        }
+
+        const Bounds &b = box.bounds;
+        if (!b.empty) {
+            const __m128d left = _mm_set1_pd(b.left);
+            const __m128d right = _mm_set1_pd(b.right);
+            const __m128d top = _mm_set1_pd(b.top);
+            const __m128d bottom = _mm_set1_pd(b.bottom);
+
+            // Negated unordered compares, so NaN bounds behave as in intersectsScalar()
+            __m128d inside = _mm_and_pd(_mm_cmpnlt_pd(px1, left), _mm_cmpngt_pd(px1, right));
+            inside = _mm_and_pd(inside, _mm_and_pd(_mm_cmpnlt_pd(py1, top), _mm_cmpngt_pd(py1, bottom)));
+            inside = _mm_and_pd(inside, _mm_and_pd(_mm_cmpnlt_pd(px2, left), _mm_cmpngt_pd(px2, right)));
+            inside = _mm_and_pd(inside, _mm_and_pd(_mm_cmpnlt_pd(py2, top), _mm_cmpngt_pd(py2, bottom)));
+
+            hit = _mm_or_pd(hit, inside);
+        }
+
+        const int mask = _mm_movemask_pd(hit);
+        result[i] = mask & 1;
+        result[i + 1] = (mask >> 1) & 1;
+    }
+
+    return i;
+}
+
+#else
+
+int intersectsVector(const Box &, const qint32 *, const qint32 *,
+                     const qint32 *, const qint32 *, int, quint8 *)
+{
+    return 0;
+}
+
+#endif
+
+}
+
+
+int PackedWalls::size() const
+{
+    return m_x1.size();
+}
+
+void PackedWalls::clear()
+{
+    m_x1.clear();
+    m_y1.clear();
+    m_x2.clear();
+    m_y2.clear();
+}
+
+void PackedWalls::assign(const QList<Wall> &walls)
+{
+    clear();
+
+    m_x1.reserve(walls.size());
+    m_y1.reserve(walls.size());
+    m_x2.reserve(walls.size());
+    m_y2.reserve(walls.size());
+
+    for (const Wall &wall : walls) {
+        append(wall);
+    }
+}
+
+void PackedWalls::append(const Wall &wall)
+{
+    insert(size(), wall);
+}
+
+void PackedWalls::insert(int index, const Wall &wall)
+{
+    m_x1.insert(index, wall.startPoint().x());
+    m_y1.insert(index, wall.startPoint().y());
+    m_x2.insert(index, wall.endPoint().x());
+    m_y2.insert(index, wall.endPoint().y());
+}
+
+void PackedWalls::removeAt(int index)
+{
+    m_x1.remove(index);
+    m_y1.remove(index);
+    m_x2.remove(index);
+    m_y2.remove(index);
+}
+
+bool PackedWalls::anyIntersects(const QRectF &rect) const
+{
+    quint8 result[BATCH_SIZE];
+
+    for (int start = 0; start < size(); start += BATCH_SIZE) {
+        int count = qMin(BATCH_SIZE, size() - start);
+        intersects(rect, m_x1.constData() + start, m_y1.constData() + start,
+                   m_x2.constData() + start, m_y2.constData() + start, count, result);
+
+        for (int i = 0; i < count; ++i) {
+            if (result[i]) return true;
+        }
+    }
+
+    return false;
+}
+
+bool PackedWalls::anyIntersects(const QRectF &rect, const QList<int> &indices) const
+{
+    QVarLengthArray<qint32, 64> x1, y1, x2, y2;
+    QVarLengthArray<quint8, 64> result(indices.size());
+
+    for (int index : indices) {
+        x1.append(m_x1[index]);
+        y1.append(m_y1[index]);
+        x2.append(m_x2[index]);
+        y2.append(m_y2[index]);
+    }
+
+    intersects(rect, x1.constData(), y1.constData(), x2.constData(), y2.constData(), indices.size(), result.data());
+
+    for (int i = 0; i < indices.size(); ++i) {
+        if (result[i]) return true;
+    }
+
+    return false;
+}
+
+void PackedWalls::intersects(const QRectF &rect, const qint32 *x1, const qint32 *y1,
+                             const qint32 *x2, const qint32 *y2, int count, quint8 *result)
+{
+    const Box box = makeBox(rect);
+
+    // Whole vectors first, the remainder one wall at a time
+    for (int i = intersectsVector(box, x1, y1, x2, y2, count, result); i < count; ++i) {
+        result[i] = intersectsScalar(box, x1[i], y1[i], x2[i], y2[i]);
+    }
+}
@@ -0,0 +1,41 @@
+#ifndef WALLKERNEL_H
+#define WALLKERNEL_H
+
+#include "wall.h"
+#include <QList>
+#include <QRectF>
+#include <QVector>
+
+
+// Wall end points packed into int columns, for testing one box against many
+// walls at once. The result for each wall is exactly what Wall::intersects()
+// returns; the SSE2/AVX paths repeat the same floating point operations as
+// QLineF::intersects() and QRectF::contains() in the same order.
+class PackedWalls {
+public:
+    int size() const;
+    void clear();
+    void assign(const QList<Wall> &walls);
+    void append(const Wall &wall);
+    void insert(int index, const Wall &wall);
+    void removeAt(int index);
+
+    bool anyIntersects(const QRectF &rect) const;
+
+    // Only the walls at the given indices, e.g. candidates from a spatial query
+    bool anyIntersects(const QRectF &rect, const QList<int> &indices) const;
+
+    // Writes 1 for every wall segment that intersects or lies inside the rect
+    static void intersects(const QRectF &rect, const qint32 *x1, const qint32 *y1,
+                           const qint32 *x2, const qint32 *y2, int count, quint8 *result);
+
+private:
+    QVector<qint32> m_x1;
+    QVector<qint32> m_y1;
+    QVector<qint32> m_x2;
+    QVector<qint32> m_y2;
+
+    static const int BATCH_SIZE = 256;
+};
+
+#endif // WALLKERNEL_H
@@ -0,0 +1,53 @@
+#include "wallsnapper.h"
+
+
+static qreal squaredDistance(const QPointF &a, const QPointF &b)
+{
+    QPointF delta = a - b;
+    return QPointF::dotProduct(delta, delta);
+}
+
+WallSnapper::Result WallSnapper::snap(const Project &project, const QPointF &cursor, qreal radius, const QPoint *from)
+{
+    Result best;
+    qreal bestDistance = 0;
+    qreal radiusSquared = radius * radius;
+
+    auto offer = [&](Kind kind, const QPointF &point, int wallIndex) {
+        qreal distance = squaredDistance(point, cursor);
+        if (distance > radiusSquared) return;
+
+        // Stronger kinds win anywhere inside the radius, otherwise the closest does
+        if (best.isValid() && (kind > best.kind || (kind == best.kind && distance >= bestDistance))) return;
+
+        best.kind = kind;
+        best.point = point.toPoint();
+        best.wallIndex = wallIndex;
+        bestDistance = distance;
+    };
+
+    QRectF area(cursor.x() - radius, cursor.y() - radius, 2 * radius, 2 * radius);
+    const QList<Wall> &walls = project.walls();
+
+    for (int i : project.wallsIn(area)) {
+        QPointF start = walls[i].startPoint();
+        QPointF end = walls[i].endPoint();
+
+        offer(Kind::Endpoint, start, i);
+        offer(Kind::Endpoint, end, i);
+        offer(Kind::Midpoint, (start + end) / 2, i);
+
+        if (!from) continue;
+
+        QPointF direction = end - start;
+        qreal lengthSquared = QPointF::dotProduct(direction, direction);
+        if (qFuzzyIsNull(lengthSquared)) continue;
+
+        qreal t = QPointF::dotProduct(QPointF(*from) - start, direction) / lengthSquared;
+        if (t < 0 || t > 1) continue;
+
+        offer(Kind::Perpendicular, start + direction * t, i);
+    }
+
+    return best;
+}
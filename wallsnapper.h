@@ -0,0 +1,35 @@
+#ifndef WALLSNAPPER_H
+#define WALLSNAPPER_H
+
+#include "project.h"
+#include <QPoint>
+#include <QPointF>
+
+
+// Snap targets on existing walls for the wall tool. Only walls returned by the
+// project's wall grid near the cursor are looked at.
+class WallSnapper {
+public:
+    enum class Kind {
+        None,
+        Endpoint,
+        Midpoint,
+        Perpendicular
+    };
+
+    struct Result {
+        Kind kind = Kind::None;
+        QPoint point;
+        int wallIndex = -1;
+
+        bool isValid() const { return kind != Kind::None; }
+    };
+
+    // Closest target within radius of the cursor. Endpoints win over midpoints,
+    // midpoints over perpendicular feet. Perpendicular feet (of the line from
+    // `from` onto a wall) are only offered when a start point is given.
+    static Result snap(const Project &project, const QPointF &cursor, qreal radius,
+                       const QPoint *from = nullptr);
+};
+
+#endif // WALLSNAPPER_H